@@ -22,6 +22,7 @@
 #include <ktexteditor/document.h>
 #include <klocalizedstring.h>
 
+#include <algorithm>
 #include <iterator>
 
 #include <interfaces/idocumentcontroller.h>
@@ -47,6 +48,8 @@
 #include "../cppduchain/environmentmanager.h"
 #include "../cppduchain/cpptypes.h"
 #include "../cppduchain/templatedeclaration.h"
+#include "../cppduchain/classmembercache.h"
+#include "../cppduchain/visibledeclarationcache.h"
 #include "../cpplanguagesupport.h"
 #include "../cpputils.h"
 #include "../debug.h"
@@ -67,6 +70,9 @@
 #define LOCKDUCHAIN     DUChainReadLocker lock(DUChain::lock())
 #include <cpputils.h>
 #include <util/foregroundlock.h>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QtConcurrentRun>
 #include <util/path.h>
 #include <interfaces/icore.h>
 #include <interfaces/ilanguagecontroller.h>
@@ -75,6 +81,26 @@ using namespace KDevelop;
 
 namespace {
 
+///Adds the time from its construction to its destruction to a phase of the completion
+class PhaseTimer
+{
+public:
+  PhaseTimer(Cpp::CodeCompletionContext* context, const QString& phase)
+    : m_context(context)
+    , m_phase(phase)
+  {
+    m_timer.start();
+  }
+  ~PhaseTimer()
+  {
+    m_context->addPhaseTime(m_phase, m_timer.nsecsElapsed());
+  }
+private:
+  Cpp::CodeCompletionContext* m_context;
+  QString m_phase;
+  QElapsedTimer m_timer;
+};
+
 ///If this is enabled, no chain of useless argument-hints for binary operators is created.
 const bool NO_MULTIPLE_BINARY_OPERATORS = true;
 ///Whether only items that are allowed to be accessed should be shown
@@ -138,6 +164,7 @@ struct MainThreadHelper : public QObject
 
   public slots:
     void replaceCurrentAccess(const QUrl &url, const QString& oldAccess, const QString& newAccess);
+    void prewarm(const QUrl &url);
 };
 
 void MainThreadHelper::replaceCurrentAccess(const QUrl &url, const QString& oldAccess, const QString& newAccess)
@@ -168,6 +195,65 @@ void MainThreadHelper::replaceCurrentAccess(const QUrl &url, const QString& oldA
   }
 }
 
+///Whether a pre-warming is running in the background. Requests arriving meanwhile are dropped.
+QAtomicInt s_prewarmRunning;
+
+/**
+ * Computes the data the completion at @p cursor in @p url will need, so the completion itself only has to filter it:
+ * The declarations visible at the cursor, and the members of the classes of the variables declared around it.
+ */
+void prewarmCompletionData(const IndexedString& url, const KTextEditor::Cursor& cursor)
+{
+  {
+    DUChainReadLocker lock(DUChain::lock());
+    TopDUContext* top = DUChainUtils::standardContextForUrl(url.toUrl());
+    DUContext* context = top ? top->findContextAt(top->transformToLocalRevision(cursor)) : 0;
+    if(context) {
+      const CursorInRevision position = context->type() == DUContext::Class ? context->range().end : top->transformToLocalRevision(cursor);
+      VisibleDeclarationCache::allDeclarations(context, position, top);
+
+      QList<DUContext*> classContexts;
+      if(Declaration* localClass = Cpp::localClassFromCodeContext(context))
+        classContexts << localClass->internalContext();
+
+      //The variables of the surrounding code-contexts, including the function-arguments
+      QList<DUContext*> scopes;
+      for(DUContext* scope = context; scope && (scope->type() == DUContext::Other || scope->type() == DUContext::Function); scope = scope->parentContext()) {
+        scopes << scope;
+        foreach(const DUContext::Import& import, scope->importedParentContexts())
+          if(DUContext* imported = import.context(top))
+            if(imported->type() == DUContext::Function)
+              scopes << imported;
+      }
+      foreach(DUContext* scope, scopes) {
+        foreach(Declaration* decl, scope->localDeclarations()) {
+          if(decl->kind() != Declaration::Instance)
+            continue;
+          StructureType::Ptr structure = TypeUtils::targetType(decl->abstractType(), top).cast<StructureType>();
+          Declaration* classDecl = structure ? structure->declaration(top) : 0;
+          if(classDecl && classDecl->internalContext() && !classContexts.contains(classDecl->internalContext()))
+            classContexts << classDecl->internalContext();
+        }
+      }
+
+      foreach(DUContext* classContext, classContexts)
+        if(classContext)
+          ClassMemberCache::allMembers(classContext, top);
+    }
+  }
+  s_prewarmRunning.store(0);
+}
+
+void MainThreadHelper::prewarm(const QUrl &url)
+{
+  IDocument* document = ICore::self()->documentController()->activeDocument();
+  if(!document || document->url() != url || !document->activeTextView())
+    return;
+  if(!s_prewarmRunning.testAndSetOrdered(0, 1))
+    return;
+  QtConcurrent::run(&prewarmCompletionData, IndexedString(url), document->activeTextView()->cursorPosition());
+}
+
 static MainThreadHelper s_mainThreadHelper;
 
 }
@@ -439,7 +525,10 @@ CodeCompletionContext( KDevelop::DUContextPointer context, const QString& text,
     m_pointerConversionsBeforeMatching( 0 ),
     m_onlyShow( ShowAll ),
     m_expressionIsTypePrefix( false ),
-    m_doAccessFiltering( DO_ACCESS_FILTERING )
+    m_doAccessFiltering( DO_ACCESS_FILTERING ),
+    m_expensiveGroupsInBackground( false ),
+    m_expensiveGroupsAborted( false ),
+    m_pendingBackgroundGroups( 0 )
 {
   if ( doIncludeCompletion() )
     return;
@@ -454,6 +543,9 @@ CodeCompletionContext( KDevelop::DUContextPointer context, const QString& text,
 
   m_followingText = followingText.trimmed();
 
+  QElapsedTimer phaseTimer;
+  phaseTimer.start();
+
   if( depth == 0 )
     preprocessText( line );
   m_text = lastNLines( m_text, CONTEXT_LINES );
@@ -472,6 +564,7 @@ CodeCompletionContext( KDevelop::DUContextPointer context, const QString& text,
   QString expressionPrefix;
   findExpressionAndPrefix( m_expression, expressionPrefix, m_expressionIsTypePrefix );
   skipUnaryOperators( expressionPrefix, m_pointerConversionsBeforeMatching );
+  addPhaseTime(QStringLiteral("find expression"), phaseTimer.nsecsElapsed());
 
   m_localClass = findLocalClass();
   m_parentContext = getParentContext( expressionPrefix );
@@ -480,7 +573,9 @@ CodeCompletionContext( KDevelop::DUContextPointer context, const QString& text,
     return;
 
   m_onlyShow = findOnlyShow( accessStr );
+  phaseTimer.restart();
   m_expressionResult = evaluateExpression();
+  addPhaseTime(QStringLiteral("evaluate expression"), phaseTimer.nsecsElapsed());
 
   m_valid = testContextValidity(expressionPrefix, accessStr);
   if (!m_valid)
@@ -490,7 +585,9 @@ CodeCompletionContext( KDevelop::DUContextPointer context, const QString& text,
        m_accessType == FunctionCallAccess ||
        m_accessType == BinaryOpFunctionCallAccess )
   {
+    phaseTimer.restart();
     m_knownArgumentTypes = getKnownArgumentTypes();
+    addPhaseTime(QStringLiteral("evaluate expression"), phaseTimer.nsecsElapsed());
 
     if ( m_accessType == BinaryOpFunctionCallAccess )
       m_operator = getEndFunctionOperator( accessStr );
@@ -1282,14 +1379,25 @@ CodeCompletionContext* CodeCompletionContext::parentContext() const {
   return static_cast<CodeCompletionContext*>(m_parentContext.data());
 }
 
-void getOverridable(DUContext* base, DUContext* current, QMap< QPair<IndexedType, IndexedString>, KDevelop::CompletionTreeItemPointer >& overridable, CodeCompletionContext::Ptr completionContext, int depth = 0) {
+bool isShallowerDeclaration(const DeclarationDepthPair& lhs, const DeclarationDepthPair& rhs) {
+  return lhs.second < rhs.second;
+}
+
+///Collects the functions of the class @p current and its base-classes that @p base can override
+void getOverridable(DUContext* base, DUContext* current, QMap< QPair<IndexedType, IndexedString>, KDevelop::CompletionTreeItemPointer >& overridable, CodeCompletionContext::Ptr completionContext) {
   if(!current)
     return;
 
-  foreach(Declaration* decl, current->localDeclarations()) {
+  //The member lists are cached, so they are not collected again for every class deriving from the same bases
+  QList<DeclarationDepthPair> members = ClassMemberCache::allMembers(current, base->topContext());
+  //Functions from the nearest classes have to win
+  std::stable_sort(members.begin(), members.end(), isShallowerDeclaration);
+
+  foreach(const DeclarationDepthPair& member, members) {
+    Declaration* decl = member.first;
     ClassFunctionDeclaration* classFun = dynamic_cast<ClassFunctionDeclaration*>(decl);
     // one can only override the direct parent's ctor
-    if(classFun && (classFun->isVirtual() || (depth == 0 && classFun->isConstructor())) && !classFun->isExplicitlyDeleted()) {
+    if(classFun && (classFun->isVirtual() || (member.second == 0 && classFun->isConstructor())) && !classFun->isExplicitlyDeleted()) {
       QPair<IndexedType, IndexedString> key = qMakePair(classFun->indexedType(), classFun->identifier().identifier());
       if(base->owner()) {
         if(classFun->isConstructor() || classFun->isDestructor())
@@ -1301,17 +1409,89 @@ void getOverridable(DUContext* base, DUContext* current, QMap< QPair<IndexedType
         overridable.insert(key, KDevelop::CompletionTreeItemPointer(new ImplementationHelperItem(ImplementationHelperItem::Override, DeclarationPointer(decl), completionContext, (classFun && classFun->isAbstract()) ? 1 : 2)));
     }
   }
-
-  foreach(const DUContext::Import &import, current->importedParentContexts())
-    getOverridable(base, import.context(base->topContext()), overridable, completionContext, depth + 1);
 }
 
 // #ifndef TEST_COMPLETION
 
 QList< QExplicitlySharedDataPointer< KDevelop::CompletionTreeElement > > CodeCompletionContext::ungroupedElements() {
+  QList<BackgroundGroup> finishedGroups;
+  {
+    QMutexLocker lock(&m_storedUngroupedItemsMutex);
+    finishedGroups.swap(m_finishedBackgroundGroups);
+  }
+  foreach(const BackgroundGroup& group, finishedGroups)
+    eventuallyAddGroup(group.name, group.priority, group.items);
+
+  QMutexLocker lock(&m_storedUngroupedItemsMutex);
   return m_storedUngroupedItems;
 }
 
+bool CodeCompletionContext::waitForExpensiveGroup(const bool& abort) {
+  ///How often @p abort is checked while waiting, in milliseconds
+  const unsigned long abortCheckInterval = 20;
+
+  QMutexLocker lock(&m_storedUngroupedItemsMutex);
+  while(m_finishedBackgroundGroups.isEmpty() && m_pendingBackgroundGroups) {
+    if(abort) {
+      m_expensiveGroupsAborted = true;
+      return false;
+    }
+    m_backgroundGroupFinished.wait(&m_storedUngroupedItemsMutex, abortCheckInterval);
+  }
+  return !m_finishedBackgroundGroups.isEmpty();
+}
+
+void CodeCompletionContext::setExpensiveGroupsInBackground(bool background) {
+  m_expensiveGroupsInBackground = background;
+}
+
+void CodeCompletionContext::addExpensiveGroup(const QString& name, int priority, const GroupComputation& computeItems) {
+  if(m_expensiveGroupsInBackground) {
+    {
+      QMutexLocker lock(&m_storedUngroupedItemsMutex);
+      ++m_pendingBackgroundGroups;
+    }
+    //Keeps this context alive until the computation is finished, even if the completion is aborted meanwhile
+    Ptr self(this);
+    QtConcurrent::run([self, name, priority, computeItems] () {
+      BackgroundGroup group;
+      group.name = name;
+      group.priority = priority;
+      {
+        PhaseTimer timer(self.data(), QStringLiteral("items: ") + name);
+        group.items = computeItems(self->m_expensiveGroupsAborted);
+      }
+      QMutexLocker lock(&self->m_storedUngroupedItemsMutex);
+      --self->m_pendingBackgroundGroups;
+      if(!self->m_expensiveGroupsAborted)
+        self->m_finishedBackgroundGroups << group;
+      self->m_backgroundGroupFinished.wakeAll();
+    });
+  }else{
+    QList<CompletionTreeItemPointer> items;
+    {
+      PhaseTimer timer(this, QStringLiteral("items: ") + name);
+      items = computeItems(m_expensiveGroupsAborted);
+    }
+    eventuallyAddGroup(name, priority, items);
+  }
+}
+
+QMap<QString, qint64> CodeCompletionContext::phaseTimes() const {
+  QMap<QString, qint64> ret;
+  if(parentContext())
+    ret = parentContext()->phaseTimes();
+  QMutexLocker lock(&m_phaseTimesMutex);
+  for(QMap<QString, qint64>::const_iterator it = m_phaseTimes.constBegin(); it != m_phaseTimes.constEnd(); ++it)
+    ret[it.key()] += it.value();
+  return ret;
+}
+
+void CodeCompletionContext::addPhaseTime(const QString& phase, qint64 nsecs) {
+  QMutexLocker lock(&m_phaseTimesMutex);
+  m_phaseTimes[phase] += nsecs;
+}
+
 QList<CompletionTreeItemPointer> CodeCompletionContext::memberAccessCompletionItems( const bool& shouldAbort )
 {
   QList<CompletionTreeItemPointer> items;
@@ -1331,7 +1511,12 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::memberAccessCompletionIt
   {
     ifDebug( qCDebug(CPP) << "missing-include completion for" << m_expression << m_expressionResult.toString(); )
     lock.unlock();
-    eventuallyAddGroup(i18n("Not Included"), 700, missingIncludeCompletionItems(m_expression, QString(), m_expressionResult, m_duContext, 0, true ));
+    const QString expression = m_expression;
+    const ExpressionEvaluationResult expressionResult = m_expressionResult;
+    const DUContextPointer context = m_duContext;
+    addExpensiveGroup(i18n("Not Included"), 700, [expression, expressionResult, context] (const bool& abort) {
+      return missingIncludeCompletionItems(expression, QString(), expressionResult, context, 0, true, &abort );
+    });
   }
 
   //Used to show only one namespace-declaration per namespace
@@ -1342,7 +1527,9 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::memberAccessCompletionIt
       return items;
     ifDebug( qCDebug(CPP) << "container:" << ctx->scopeIdentifier(true).toString(); )
 
-    QList<DeclarationDepthPair> decls = ctx->allDeclarations(ctx->range().end, m_duContext->topContext(), false );
+    QList<DeclarationDepthPair> decls = ctx->type() == DUContext::Class
+                                        ? ClassMemberCache::allMembers(ctx, m_duContext->topContext())
+                                        : ctx->allDeclarations(ctx->range().end, m_duContext->topContext(), false );
     decls += namespaceItems(ctx, ctx->range().end, false, containers);
 
     foreach( const DeclarationDepthPair& decl, Cpp::hideOverloadedDeclarations(decls, typeIsConst ) )
@@ -1599,7 +1786,7 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::signalSlotAccessCompleti
           Declaration* signalContainer = signalContainerType->declaration(m_duContext->topContext());
         if(signalContainer && signalContainer->internalContext()) {
           IndexedString signature(m_connectedSignalNormalizedSignature);
-          foreach(const DeclarationDepthPair &decl, signalContainer->internalContext()->allDeclarations( CursorInRevision::invalid(), m_duContext->topContext(), false )) {
+          foreach(const DeclarationDepthPair &decl, ClassMemberCache::allMembers(signalContainer->internalContext(), m_duContext->topContext())) {
             if(decl.first->identifier() == m_connectedSignalIdentifier) {
               if(QtFunctionDeclaration* classFun = dynamic_cast<QtFunctionDeclaration*>(decl.first)) {
                 if(classFun->isSignal() && classFun->normalizedSignature() == signature) {
@@ -1632,7 +1819,7 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::signalSlotAccessCompleti
           signalSlots << CompletionTreeItemPointer(new ImplementationHelperItem(ImplementationHelperItem::CreateSignalSlot, DeclarationPointer(connectedSignal.data()), CodeCompletionContext::Ptr(this)));
         }
 
-        foreach(const DeclarationDepthPair &candidate, decl->internalContext()->allDeclarations(CursorInRevision::invalid(), m_duContext->topContext(), false) ) {
+        foreach(const DeclarationDepthPair &candidate, ClassMemberCache::allMembers(decl->internalContext(), m_duContext->topContext()) ) {
           if(QtFunctionDeclaration* classFun = dynamic_cast<QtFunctionDeclaration*>(candidate.first)) {
             if((classFun->isSignal() && m_onlyShow != ShowSlots) || (accessType() == SlotAccess && classFun->isSlot() && filterDeclaration(classFun))) {
               NormalDeclarationCompletionItem* item = new NormalDeclarationCompletionItem( DeclarationPointer(candidate.first), KDevelop::CodeCompletionContext::Ptr(this), candidate.second );
@@ -1877,7 +2064,7 @@ QList< CompletionTreeItemPointer > CodeCompletionContext::standardAccessCompleti
     if (func->abstractType() && (func->abstractType()->modifiers() & AbstractType::ConstModifier))
       typeIsConst = true;
   }
-  QList<DeclarationDepthPair> decls = m_duContext->allDeclarations(m_duContext->type() == DUContext::Class ? m_duContext->range().end : m_position, m_duContext->topContext());
+  QList<DeclarationDepthPair> decls = VisibleDeclarationCache::allDeclarations(m_duContext.data(), m_duContext->type() == DUContext::Class ? m_duContext->range().end : m_position, m_duContext->topContext());
   decls += namespaceItems(m_duContext.data(), m_position, true);
 
   QList<DeclarationDepthPair> oldDecls = decls;
@@ -1994,6 +2181,9 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::completionItems(bool& sh
     if(shouldAddParentItems(fullCompletion))
       items = parentContext()->completionItems( shouldAbort, fullCompletion );
 
+    QElapsedTimer phaseTimer;
+    phaseTimer.start();
+
     switch(m_accessType) {
       case MemberAccess:
       case ArrowMemberAccess:
@@ -2031,19 +2221,44 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::completionItems(bool& sh
         {
           items += standardAccessCompletionItems();
 #ifndef TEST_COMPLETION
-          eventuallyAddGroup(i18n("Not Included"), 700, missingIncludeCompletionItems(m_followingText + ':', {}, {}, m_duContext));
+          {
+            const QString expression = m_followingText + ':';
+            const DUContextPointer context = m_duContext;
+            addExpensiveGroup(i18n("Not Included"), 700, [expression, context] (const bool& abort) {
+              return missingIncludeCompletionItems(expression, {}, {}, context, 0, false, &abort);
+            });
+          }
 #endif
           addCPPBuiltin();
         }
         break;
     }
 
-    LOCKDUCHAIN; if (!m_duContext) return items;
+    addPhaseTime(QStringLiteral("items"), phaseTimer.nsecsElapsed());
+
     if (m_accessType == MemberAccess ||
         m_accessType == ArrowMemberAccess ||
         m_accessType == MemberChoose ||
         m_accessType == NoMemberAccess)
-      addLookaheadMatches(items);
+    {
+      //The match-types are computed lazily by the parent-context, so not from within the background computation
+      QList<IndexedType> matchTypes;
+      {
+        LOCKDUCHAIN;
+        if (m_parentContext)
+          matchTypes = parentContext()->matchTypes();
+      }
+      if (!matchTypes.isEmpty()) {
+        addExpensiveGroup(i18n("Lookahead Matches"), 800, [this, items, matchTypes] (const bool& abort) {
+          LOCKDUCHAIN; if (!m_duContext) return QList<CompletionTreeItemPointer>();
+          return lookaheadMatches(items, matchTypes, abort);
+        });
+      }
+    }
+
+    LOCKDUCHAIN; if (!m_duContext) return items;
+
+    PhaseTimer timer(this, QStringLiteral("items: special"));
 
     if (parentContext()) {
       foreach(const IndexedType &matchType, parentContext()->matchTypes()) {
@@ -2062,17 +2277,13 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::completionItems(bool& sh
     return items;
 }
 
-void CodeCompletionContext::addLookaheadMatches(const QList<CompletionTreeItemPointer> items)
+QList<CompletionTreeItemPointer> CodeCompletionContext::lookaheadMatches(const QList<CompletionTreeItemPointer>& items, const QList<IndexedType>& matchTypes, const bool& shouldAbort)
 {
-  QList<IndexedType> matchTypes;
-  if (m_parentContext)
-    matchTypes = parentContext()->matchTypes();
-
-  if (!matchTypes.size())
-    return;
-
   QList<CompletionTreeItemPointer> lookaheadMatches;
+
   foreach( const CompletionTreeItemPointer &item, items ) {
+    if (shouldAbort)
+      break;
     Declaration* decl = item->declaration().data();
     if (!decl)
       continue;
@@ -2091,7 +2302,7 @@ void CodeCompletionContext::addLookaheadMatches(const QList<CompletionTreeItemPo
   }
   m_lookaheadMatchesCache.clear();
 
-  eventuallyAddGroup(i18n("Lookahead Matches"), 800, lookaheadMatches);
+  return lookaheadMatches;
 }
 
 QList<CompletionTreeItemPointer> CodeCompletionContext::getImplementationHelpers() {
@@ -2334,6 +2545,12 @@ void CodeCompletionContext::replaceCurrentAccess(const QString& old, const QStri
                             Q_ARG(QUrl, m_duContext->url().toUrl()), Q_ARG(QString, old), Q_ARG(QString, _new));
 }
 
+void CodeCompletionContext::prewarm(const IndexedString& url)
+{
+  //The cursor-position can only be retrieved in the foreground
+  QMetaObject::invokeMethod(&s_mainThreadHelper, "prewarm", Qt::QueuedConnection, Q_ARG(QUrl, url.toUrl()));
+}
+
 int CodeCompletionContext::matchPosition() const {
   return m_knownArgumentExpressions.count();
 }
@@ -2343,6 +2560,7 @@ void CodeCompletionContext::eventuallyAddGroup(QString name, int priority, QList
     return;
   KDevelop::CompletionCustomGroupNode* node = new KDevelop::CompletionCustomGroupNode(name, priority);
   node->appendChildren(items);
+  QMutexLocker lock(&m_storedUngroupedItemsMutex);
   m_storedUngroupedItems << CompletionTreeElementPointer(node);
 }
 
@@ -26,6 +26,12 @@
 #include "item.h"
 #include <language/codecompletion/codecompletioncontext.h>
 
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <functional>
+
 namespace KTextEditor {
   class View;
   class Cursor;
@@ -63,6 +69,36 @@ namespace Cpp {
       
       virtual QList< QExplicitlySharedDataPointer< KDevelop::CompletionTreeElement > > ungroupedElements() override;
 
+      ///If this is enabled, completionItems() computes the expensive groups ("Not Included", lookahead matches) in
+      ///background threads, while the remaining items are computed and grouped. ungroupedElements() does not wait
+      ///for them, it only contains the groups that are finished. Use waitForExpensiveGroup() to wait for the others.
+      void setExpensiveGroupsInBackground(bool background);
+
+      /**
+       * Blocks until another expensive group was computed in the background, see setExpensiveGroupsInBackground().
+       * @return Whether a group finished, it is then contained in ungroupedElements(). False if no computation is
+       *         pending anymore, or if @p abort was set, in which case the pending computations are aborted.
+       * @warning Must be called with the du-chain unlocked
+       * */
+      bool waitForExpensiveGroup(const bool& abort);
+
+      /**
+       * Returns the time spent in the phases of this completion, and of its parent-contexts, in nanoseconds by phase name.
+       * The phases are "find expression", "evaluate expression", "items", "items: special", "items: <group>" for the
+       * expensive groups, and the ones recorded by the worker, "grouping" and "presentation". Expensive groups that are
+       * not computed in the background are also contained in "items".
+       * */
+      QMap<QString, qint64> phaseTimes() const;
+
+      ///Adds @p nsecs to the time spent in @p phase. Thread-safe.
+      void addPhaseTime(const QString& phase, qint64 nsecs);
+
+      /**
+       * Speculatively computes the data a completion at the cursor of the active view will need, if it shows @p url.
+       * Returns immediately, the computation happens in the background.
+       * */
+      static void prewarm(const KDevelop::IndexedString& url);
+
       typedef QExplicitlySharedDataPointer<CodeCompletionContext> Ptr;
 
       typedef OverloadResolutionFunction Function;
@@ -254,7 +290,8 @@ namespace Cpp {
       ///If @param forDecl is an instance of a class, find declarations in that class which match @param matchTypes
       ///@returns the list of matching declarations and whether or not you need the arrow operator (->) to access them
       QList<DeclAccessPair> getLookaheadMatches(Declaration* forDecl, const QList<IndexedType>& matchTypes) const;
-      void addLookaheadMatches(const QList<CompletionTreeItemPointer> items);
+      ///*DUChain must be locked*
+      QList<CompletionTreeItemPointer> lookaheadMatches(const QList<CompletionTreeItemPointer>& items, const QList<IndexedType>& matchTypes, const bool& shouldAbort);
       ///For a given @param container, find members which may potentially be used for lookahead matching
       ///@param isPointer specifies whether the container should be accessed with operator->
       ///@returns a list of declarations paired with whether or not they use "operator->"
@@ -272,6 +309,11 @@ namespace Cpp {
 
       ///Creates the group and adds it to m_storedUngroupedItems if items is not empty
       void eventuallyAddGroup(QString name, int priority, QList< QExplicitlySharedDataPointer< KDevelop::CompletionTreeItem > > items);
+
+      typedef std::function<QList<CompletionTreeItemPointer> (const bool& abort)> GroupComputation;
+      ///Like eventuallyAddGroup, but if expensive groups are computed in the background, the items are only added once they are finished
+      ///@param computeItems is called with the du-chain unlocked, and should return early once its @p abort parameter is set
+      void addExpensiveGroup(const QString& name, int priority, const GroupComputation& computeItems);
       
       ///@param type The type of the argument the items are matched to.
       ///*DUChain must be locked*
@@ -339,6 +381,24 @@ namespace Cpp {
       int m_pointerConversionsBeforeMatching; 
 
       QList<KDevelop::CompletionTreeElementPointer> m_storedUngroupedItems;
+      //Guards m_storedUngroupedItems and the background groups
+      mutable QMutex m_storedUngroupedItemsMutex;
+
+      struct BackgroundGroup {
+        QString name;
+        int priority;
+        QList<CompletionTreeItemPointer> items;
+      };
+      bool m_expensiveGroupsInBackground;
+      //Set once the completion was aborted, the background computations check it
+      bool m_expensiveGroupsAborted;
+      int m_pendingBackgroundGroups;
+      //Groups computed in the background that were not added to m_storedUngroupedItems yet
+      QList<BackgroundGroup> m_finishedBackgroundGroups;
+      QWaitCondition m_backgroundGroupFinished;
+
+      QMap<QString, qint64> m_phaseTimes;
+      mutable QMutex m_phaseTimesMutex;
 
       //A specific completion item type to show, or ShowAll, see enum OnlyShow
       OnlyShow m_onlyShow;
@@ -46,6 +46,7 @@
 #include <ktexteditor/movingrange.h>
 #include <ktexteditor/movinginterface.h>
 #include <memory>
+#include <QMutex>
 using namespace KDevelop;
 
 namespace {
@@ -467,8 +468,11 @@ bool NormalDeclarationCompletionItem::completingTemplateParameters() const
 
 QString NormalDeclarationCompletionItem::shortenedTypeString(KDevelop::DeclarationPointer decl, int desiredTypeLength) const
 {
-  if(m_cachedTypeStringDecl == decl && m_cachedTypeStringLength == static_cast<uint>(desiredTypeLength))
-    return m_cachedTypeString;
+  {
+    QMutexLocker lock(&m_displayDataMutex);
+    if(m_cachedTypeStringDecl == decl && m_cachedTypeStringLength == static_cast<uint>(desiredTypeLength))
+      return m_cachedTypeString;
+  }
 
   QString ret;
 
@@ -477,6 +481,7 @@ QString NormalDeclarationCompletionItem::shortenedTypeString(KDevelop::Declarati
   else
     ret = KDevelop::NormalDeclarationCompletionItem::shortenedTypeString(decl, desiredTypeLength);
 
+  QMutexLocker lock(&m_displayDataMutex);
   m_cachedTypeString = ret;
   m_cachedTypeStringDecl = decl;
   m_cachedTypeStringLength = desiredTypeLength;
@@ -654,11 +659,8 @@ QVariant NormalDeclarationCompletionItem::data(const QModelIndex& index, int rol
           if(completingTemplateParameters())
             createTemplateArgumentList(*this, ret, 0);
 
-          if (dec->type<FunctionType>()) {
-            needCachedArgumentList();
-
-            return m_cachedArgumentList->text;
-          }
+          if (dec->type<FunctionType>())
+            return needCachedArgumentList()->text;
 
           return ret;
         }
@@ -695,9 +697,7 @@ QVariant NormalDeclarationCompletionItem::data(const QModelIndex& index, int rol
 
     case CodeCompletionModel::CustomHighlight:
     if( index.column() == CodeCompletionModel::Arguments /*&& completionContext()->memberAccessOperation() == Cpp::CodeCompletionContext::FunctionCallAccess*/ ) {
-      needCachedArgumentList();
-
-      return QVariant(m_cachedArgumentList->highlighting);
+      return QVariant(needCachedArgumentList()->highlighting);
     }
 //     if( index.column() == CodeCompletionModel::Name ) {
 //       //Bold
@@ -736,22 +736,64 @@ QVariant NormalDeclarationCompletionItem::data(const QModelIndex& index, int rol
   return QVariant();
 }
 
-void NormalDeclarationCompletionItem::needCachedArgumentList() const
+QExplicitlySharedDataPointer<CachedArgumentList> NormalDeclarationCompletionItem::needCachedArgumentList() const
 {
-  if(!m_cachedArgumentList)
   {
-    m_cachedArgumentList = QExplicitlySharedDataPointer<CachedArgumentList>(new CachedArgumentList);
-
-    if(!m_declaration)
-      return;
+    QMutexLocker lock(&m_displayDataMutex);
+    if(m_cachedArgumentList)
+      return m_cachedArgumentList;
+  }
 
+  QExplicitlySharedDataPointer<CachedArgumentList> argumentList(new CachedArgumentList);
+  if(m_declaration) {
     if(m_isTemplateCompletion || declarationNeedsTemplateParameters(m_declaration.data()))
-      createTemplateArgumentList(*this, m_cachedArgumentList->text, &m_cachedArgumentList->highlighting);
-
+      createTemplateArgumentList(*this, argumentList->text, &argumentList->highlighting);
 
     if (m_declaration->type<FunctionType>())
-      createArgumentList(*this, m_cachedArgumentList->text, &m_cachedArgumentList->highlighting);
+      createArgumentList(*this, argumentList->text, &argumentList->highlighting);
   }
+
+  //If the list was prepared concurrently, keep the first one, so all users see the same
+  QMutexLocker lock(&m_displayDataMutex);
+  if(!m_cachedArgumentList)
+    m_cachedArgumentList = argumentList;
+  return m_cachedArgumentList;
+}
+
+bool NormalDeclarationCompletionItem::showsTypeString() const
+{
+  //Same as the Prefix column in data()
+  if(!m_declaration->abstractType() || m_declaration->kind() == Declaration::Type || m_declaration->kind() == Declaration::Namespace
+     || m_declaration->type<EnumeratorType>())
+    return false;
+  FunctionType::Ptr functionType = m_declaration->type<FunctionType>();
+  return !functionType || functionType->returnType();
+}
+
+void NormalDeclarationCompletionItem::prepareDisplayData() const
+{
+  if(!m_declaration || useAlternativeText)
+    return;
+
+  if(m_declaration->type<FunctionType>())
+    needCachedArgumentList();
+
+  if(showsTypeString())
+    shortenedTypeString(m_declaration, desiredTypeLength);
+}
+
+bool NormalDeclarationCompletionItem::isDisplayDataPrepared() const
+{
+  if(!m_declaration || useAlternativeText)
+    return true;
+
+  const bool needsArgumentList = m_declaration->type<FunctionType>();
+  const bool needsTypeString = showsTypeString();
+
+  QMutexLocker lock(&m_displayDataMutex);
+  if(needsArgumentList && !m_cachedArgumentList)
+    return false;
+  return !needsTypeString || (m_cachedTypeStringDecl == m_declaration && m_cachedTypeStringLength == static_cast<uint>(desiredTypeLength));
 }
 
 QWidget* NormalDeclarationCompletionItem::createExpandingWidget(const KDevelop::CodeCompletionModel* model) const
@@ -22,6 +22,8 @@
 #ifndef COMPLETIONITEM_H
 #define COMPLETIONITEM_H
 
+#include <QMutex>
+
 #include <language/duchain/duchainpointer.h>
 #include <language/duchain/types/structuretype.h>
 #include <language/codecompletion/codecompletionitem.h>
@@ -96,13 +98,20 @@ public:
 
   QExplicitlySharedDataPointer<CodeCompletionContext> completionContext() const;
 
+  ///Computes the argument-list and type-string shown for this item, so data() does not have to compute them in the foreground.
+  ///May be called from a background thread. @warning The du-chain must be read-locked
+  void prepareDisplayData() const;
+  ///Whether data() can show this item without computing anything. @warning The du-chain must be read-locked
+  bool isDisplayDataPrepared() const;
+
 protected:
   virtual QWidget* createExpandingWidget(const KDevelop::CodeCompletionModel* model) const override;
   virtual bool createsExpandingWidget() const override;
   virtual QString shortenedTypeString(KDevelop::DeclarationPointer decl, int desiredTypeLength) const override;
 private:
   
-  void needCachedArgumentList() const;
+  QExplicitlySharedDataPointer<CachedArgumentList> needCachedArgumentList() const;
+  bool showsTypeString() const;
   
   QString keepRemainingWord(const KDevelop::Identifier& id);
   QString keepRemainingWord(const KDevelop::StructureType::Ptr &type, const KDevelop::Identifier &id, const QString &insertAccessor);
@@ -114,6 +123,8 @@ private:
   mutable uint m_cachedTypeStringLength;
   
   mutable QExplicitlySharedDataPointer<CachedArgumentList> m_cachedArgumentList;
+  ///Protects the cached presentation data, as it may be prepared in the background while the list is shown
+  mutable QMutex m_displayDataMutex;
 };
 
 // Helper-item that manages the number of shown argument-hints
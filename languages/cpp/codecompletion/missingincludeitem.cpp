@@ -37,6 +37,7 @@
 #include "../cppduchain/typeutils.h"
 #include "../cppduchain/templateparameterdeclaration.h"
 #include "../cppduchain/expressionevaluationresult.h"
+#include "../cppduchain/globalsymbolindex.h"
 
 #include "../cpputils.h"
 #include "../debug.h"
@@ -48,6 +49,8 @@
 //Whether relative urls like "../bla" should be allowed. Even if this is false, they will be preferred over global urls.
 static const bool allowDotDot = true;
 const uint maxDeclarationCount = 30;
+//Partially typed names shorter than this are not expanded through the global symbol index, they would match too much
+const int minimumPartialNameLength = 3;
 
 using namespace KTextEditor;
 using namespace KDevelop;
@@ -270,7 +273,8 @@ QList<KDevelop::CompletionTreeItemPointer> missingIncludeCompletionItems(const Q
                                                                          const Cpp::ExpressionEvaluationResult& expressionResult,
                                                                          const KDevelop::DUContextPointer& context,
                                                                          int argumentHintDepth,
-                                                                         bool needInstance)
+                                                                         bool needInstance,
+                                                                         const bool* abort)
 {
   DUChainReadLocker lock;
   if (!context)
@@ -348,12 +352,33 @@ QList<KDevelop::CompletionTreeItemPointer> missingIncludeCompletionItems(const Q
 
   QSet<DeclarationId> haveForwardDeclarationItems;
 
-  ///Search the persistent symbol table
+  QList<QualifiedIdentifier> searchIdentifiers;
   foreach(QualifiedIdentifier prefix, prefixes) {
     prefix.setExplicitlyGlobal(false);
+    searchIdentifiers << prefix + identifier;
+  }
+
+  if(!type && identifier.count() == 1) {
+    //The name may only be partially typed, so also search for the global symbols it is a prefix or the camel-case humps of
+    QString name = identifier.last().identifier().str();
+    while(name.endsWith(':'))
+      name.chop(1);
+    if(name.length() >= minimumPartialNameLength) {
+      const QList<QualifiedIdentifier> partialMatches = GlobalSymbolIndex::findByPrefix(name, maxDeclarationCount)
+                                                        + GlobalSymbolIndex::findByCamelCase(name, maxDeclarationCount);
+      foreach(const QualifiedIdentifier& id, partialMatches) {
+        if(!searchIdentifiers.contains(id))
+          searchIdentifiers << id;
+      }
+    }
+  }
+
+  ///Search the persistent symbol table
+  foreach(const QualifiedIdentifier& id, searchIdentifiers) {
+    if(abort && *abort)
+      return ret;
     const IndexedDeclaration* declarations;
     uint declarationCount;
-    QualifiedIdentifier id = prefix + identifier;
 
     PersistentSymbolTable::self().declarations( id, declarationCount, declarations );
 
@@ -59,12 +59,14 @@ class ForwardDeclarationItem : public NormalDeclarationCompletionItem {
 
 ///DUChain must be locked
 ///@param displayTextPrefix may be needed so the created items pass a specific filtering in the completion-list
+///@param abort if given, the search returns early once it is set
 QList<KDevelop::CompletionTreeItemPointer> missingIncludeCompletionItems(const QString& expression,
                                                                          const QString& displayTextPrefix,
                                                                          const Cpp::ExpressionEvaluationResult& expressionResult,
                                                                          const KDevelop::DUContextPointer& context,
                                                                          int argumentHintDepth = 0,
-                                                                         bool needInstance = false);
+                                                                         bool needInstance = false,
+                                                                         const bool* abort = 0);
 
 ///DUChain must be locked
 QExplicitlySharedDataPointer<MissingIncludeCompletionItem> includeDirectiveFromUrl(const QUrl &fromUrl, const KDevelop::IndexedDeclaration& decl);
@@ -23,6 +23,7 @@
 #include "worker.h"
 
 #include "context.h"
+#include "item.h"
 #include "../debug.h"
 
 #include <language/duchain/duchain.h>
@@ -30,17 +31,48 @@
 #include <language/duchain/types/functiontype.h>
 #include <language/duchain/parsingenvironment.h>
 
+#include <QElapsedTimer>
+
 using namespace KDevelop;
 
+namespace {
+///Count of items per group that are shown without scrolling, they are prepared first
+const int firstVisibleItems = 50;
+///Count of items prepared while holding the du-chain lock once
+const int preparationBatchSize = 50;
+
+void collectItemsByGroup(const QList<CompletionTreeElementPointer>& elements, QList<Cpp::NormalDeclarationCompletionItem*>& ungrouped,
+                         QList<QList<Cpp::NormalDeclarationCompletionItem*> >& groups)
+{
+  foreach(const CompletionTreeElementPointer& element, elements) {
+    if(CompletionTreeNode* node = element->asNode()) {
+      QList<Cpp::NormalDeclarationCompletionItem*> group;
+      QList<QList<Cpp::NormalDeclarationCompletionItem*> > subGroups;
+      collectItemsByGroup(node->children, group, subGroups);
+      groups << group << subGroups;
+    } else if(Cpp::NormalDeclarationCompletionItem* item = dynamic_cast<Cpp::NormalDeclarationCompletionItem*>(element->asItem())) {
+      ungrouped << item;
+    }
+  }
+}
+}
+
 namespace Cpp {
 
 CodeCompletionWorker::CodeCompletionWorker(CodeCompletionModel* model)
   : KDevelop::CodeCompletionWorker(model)
+  , m_deliveredTreeSize(-1)
 {
+  //Runs in this thread while the model inserts the items in the foreground
+  connect(this, &CodeCompletionWorker::foundDeclarations, this, &CodeCompletionWorker::completionsFound, Qt::DirectConnection);
 }
 KDevelop::CodeCompletionContext* CodeCompletionWorker::createCompletionContext(KDevelop::DUContextPointer context, const QString &contextText, const QString &followingText, const KDevelop::CursorInRevision& position) const
 {
-  return new Cpp::CodeCompletionContext( context, contextText, followingText, position );
+  Cpp::CodeCompletionContext* ret = new Cpp::CodeCompletionContext( context, contextText, followingText, position );
+  //The expensive groups are computed while the other items are computed and grouped, computeCompletions() delivers them
+  ret->setExpensiveGroupsInBackground(true);
+  m_currentContext = Cpp::CodeCompletionContext::Ptr(ret);
+  return ret;
 }
 
 void CodeCompletionWorker::updateContextRange(KTextEditor::Range& contextRange, KTextEditor::View*, DUContextPointer context) const
@@ -73,7 +105,78 @@ void CodeCompletionWorker::computeCompletions(KDevelop::DUContextPointer context
 
   Cpp::TypeConversionCacheEnabler enableConversionCache;
 
+  m_currentContext.reset();
+  m_groupedTree.clear();
+  m_deliveredTreeSize = -1;
   KDevelop::CodeCompletionWorker::computeCompletions(context, position, followingText, contextRange, contextText);
+
+  Cpp::CodeCompletionContext::Ptr completionContext;
+  completionContext.swap(m_currentContext);
+  if(!completionContext)
+    return;
+
+  //Deliver the expensive groups one by one as they finish, each time with the items that were delivered before.
+  //If the completion is aborted or was not delivered, the remaining computations are aborted.
+  while(completionContext->waitForExpensiveGroup(aborting())) {
+    const QList<CompletionTreeElementPointer> tree = m_groupedTree + completionContext->ungroupedElements();
+    if(m_deliveredTreeSize == -1 || tree.size() == m_deliveredTreeSize)
+      continue;
+    emit foundDeclarations(tree, KDevelop::CodeCompletionContext::Ptr(completionContext.data()));
+  }
+}
+
+QList<CompletionTreeElementPointer> CodeCompletionWorker::computeGroups(QList<CompletionTreeItemPointer> items, QExplicitlySharedDataPointer<KDevelop::CodeCompletionContext> completionContext)
+{
+  QElapsedTimer phaseTimer;
+  phaseTimer.start();
+  QList<CompletionTreeElementPointer> tree = KDevelop::CodeCompletionWorker::computeGroups(items, completionContext);
+  if(Cpp::CodeCompletionContext* cppContext = dynamic_cast<Cpp::CodeCompletionContext*>(completionContext.data()))
+    cppContext->addPhaseTime(QStringLiteral("grouping"), phaseTimer.nsecsElapsed());
+  m_groupedTree = tree;
+  return tree;
+}
+
+void CodeCompletionWorker::completionsFound(const QList<CompletionTreeElementPointer>& tree, const QExplicitlySharedDataPointer<KDevelop::CodeCompletionContext>& completionContext)
+{
+  m_deliveredTreeSize = tree.size();
+
+  QElapsedTimer phaseTimer;
+  phaseTimer.start();
+  prepareDisplayData(tree);
+
+  Cpp::CodeCompletionContext* cppContext = dynamic_cast<Cpp::CodeCompletionContext*>(completionContext.data());
+  if(!cppContext)
+    return;
+  cppContext->addPhaseTime(QStringLiteral("presentation"), phaseTimer.nsecsElapsed());
+
+  if(CPPCOMPLETIONTIMING().isDebugEnabled()) {
+    const QMap<QString, qint64> times = cppContext->phaseTimes();
+    for(QMap<QString, qint64>::const_iterator it = times.constBegin(); it != times.constEnd(); ++it)
+      qCDebug(CPPCOMPLETIONTIMING) << it.key() << ":" << it.value() / 1000 << "us";
+  }
+}
+
+void CodeCompletionWorker::prepareDisplayData(const QList<CompletionTreeElementPointer>& elements)
+{
+  QList<NormalDeclarationCompletionItem*> ungrouped;
+  QList<QList<NormalDeclarationCompletionItem*> > groups;
+  collectItemsByGroup(elements, ungrouped, groups);
+  groups.prepend(ungrouped);
+
+  //The top of every group comes first, as that is what is shown when the list opens, then the rest in list order
+  QList<NormalDeclarationCompletionItem*> items;
+  foreach(const QList<NormalDeclarationCompletionItem*>& group, groups)
+    items += group.mid(0, firstVisibleItems);
+  foreach(const QList<NormalDeclarationCompletionItem*>& group, groups)
+    items += group.mid(firstVisibleItems);
+
+  for(int start = 0; start < items.size() && !aborting(); start += preparationBatchSize) {
+    //Only hold the lock briefly, the foreground reads the items meanwhile
+    DUChainReadLocker lock(DUChain::lock());
+    for(int a = start; a < qMin(start + preparationBatchSize, items.size()); ++a)
+      if(!items[a]->isDisplayDataPrepared())
+        items[a]->prepareDisplayData();
+  }
 }
 
 }
@@ -26,6 +26,7 @@
 #include <language/codecompletion/codecompletionworker.h>
 
 #include "model.h"
+#include "context.h"
 
 namespace Cpp {
 
@@ -42,6 +43,21 @@ class CodeCompletionWorker : public KDevelop::CodeCompletionWorker
     virtual void computeCompletions(KDevelop::DUContextPointer context, const KTextEditor::Cursor& position, QString followingText, const KTextEditor::Range& _contextRange, const QString& _contextText) override;
     virtual KDevelop::CodeCompletionContext* createCompletionContext(KDevelop::DUContextPointer context, const QString &contextText, const QString &followingText, const KDevelop::CursorInRevision &position) const override;
     virtual void updateContextRange(KTextEditor::Range& contextRange, KTextEditor::View* view, KDevelop::DUContextPointer context) const override;
+    virtual QList<KDevelop::CompletionTreeElementPointer> computeGroups(QList<KDevelop::CompletionTreeItemPointer> items, QExplicitlySharedDataPointer<KDevelop::CodeCompletionContext> completionContext) override;
+
+  private slots:
+    ///Called from the worker thread whenever completions were delivered to the model
+    void completionsFound(const QList<KDevelop::CompletionTreeElementPointer>& tree, const QExplicitlySharedDataPointer<KDevelop::CodeCompletionContext>& completionContext);
+
+  private:
+    ///Computes the presentation data of the items in the background, so scrolling through long lists does not compute it in the foreground
+    void prepareDisplayData(const QList<KDevelop::CompletionTreeElementPointer>& elements);
+
+    ///The context of the running completion, its expensive groups are delivered once the other items were
+    mutable QExplicitlySharedDataPointer<CodeCompletionContext> m_currentContext;
+    ///The grouped items of the running completion, and the count of elements last delivered to the model
+    QList<KDevelop::CompletionTreeElementPointer> m_groupedTree;
+    int m_deliveredTreeSize;
 };
 
 }
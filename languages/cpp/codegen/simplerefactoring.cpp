@@ -24,6 +24,10 @@
 #include "../debug.h"
 
 #include <QAction>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QtConcurrentMap>
 #include <KMessageBox>
 #include <ktexteditor/document.h>
 #include <kparts/mainwindow.h>
@@ -51,9 +55,63 @@
 #include <templatedeclaration.h>
 #include <sourcemanipulation.h>
 
+#include <limits>
+
 using namespace KDevelop;
 
+namespace {
+
+void collectUseChanges(const DUContext* context, int usedDeclarationIndex, const QString& oldName, const QString& newName, QList<DocumentChange>& changes)
+{
+  for(int a = 0; a < context->usesCount(); ++a) {
+    const Use& use(context->uses()[a]);
+    if(use.m_declarationIndex != usedDeclarationIndex || use.m_range.isEmpty())
+      continue;
+    changes << DocumentChange(context->url(), context->transformFromLocalRevision(use.m_range), oldName, newName);
+  }
+
+  foreach(const DUContext* child, context->childContexts())
+    collectUseChanges(child, usedDeclarationIndex, oldName, newName, changes);
+}
+
+///Functor for QtConcurrent, collects the changes for the uses of the renamed declarations in one file
+struct UseChangeCollector
+{
+  typedef QList<DocumentChange> result_type;
+
+  UseChangeCollector(const QList<IndexedDeclaration>& declarations, const QString& oldName, const QString& newName)
+    : declarations(declarations), oldName(oldName), newName(newName)
+  {
+  }
+
+  QList<DocumentChange> operator()(const IndexedTopDUContext& file) const
+  {
+    QList<DocumentChange> changes;
+    //Only this file is locked, so parsing and the UI can go on between the files
+    DUChainReadLocker lock;
+    TopDUContext* top = file.data();
+    if(!top)
+      return changes;
+
+    QSet<int> hadIndices;
+    foreach(const IndexedDeclaration& decl, declarations) {
+      Declaration* declaration = decl.data();
+      if(!declaration)
+        continue;
+      const int usedDeclarationIndex = top->indexForUsedDeclaration(declaration, false);
+      if(usedDeclarationIndex == std::numeric_limits<int>::max() || hadIndices.contains(usedDeclarationIndex))
+        continue;
+      hadIndices.insert(usedDeclarationIndex);
+      collectUseChanges(top, usedDeclarationIndex, oldName, newName, changes);
+    }
+    return changes;
+  }
+
+  QList<IndexedDeclaration> declarations;
+  QString oldName, newName;
+};
 
+}
 
 SimpleRefactoring::SimpleRefactoring(QObject *parent)
   : BasicRefactoring(parent)
@@ -292,7 +350,9 @@ void SimpleRefactoring::startInteractiveRename(const KDevelop::IndexedDeclaratio
     if (nc.newName == originalName || nc.newName.isEmpty())
         return;
 
-    DocumentChangeSet changes = BasicRefactoring::renameCollectedDeclarations(nc.collector.data(), nc.newName, originalName, false);
+    DocumentChangeSet changes;
+    if (!renameCollectedDeclarationsInParallel(nc.collector.data(), nc.newName, originalName, changes))
+        return;
 
     changes.setFormatPolicy(KDevelop::DocumentChangeSet::NoAutoFormat);
 
@@ -301,6 +361,47 @@ void SimpleRefactoring::startInteractiveRename(const KDevelop::IndexedDeclaratio
     QMetaObject::invokeMethod(this, "applyChangesDelayed", Qt::QueuedConnection);
 }
 
+bool SimpleRefactoring::renameCollectedDeclarationsInParallel(BasicRefactoringCollector* collector, const QString& newName,
+                                                              const QString& oldName, DocumentChangeSet& changes)
+{
+    const QVector<IndexedTopDUContext> files = collector->allUsingContexts();
+    QFuture<QList<DocumentChange> > future = QtConcurrent::mapped(files, UseChangeCollector(collector->declarations(), oldName, newName));
+
+    //Keep the UI responsive while waiting, and allow cancelling
+    QProgressDialog progress(i18n("Collecting the uses of %1...", oldName), i18n("Cancel"), 0, files.size(), ICore::self()->uiController()->activeMainWindow());
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    QFutureWatcher<QList<DocumentChange> > watcher;
+    QEventLoop loop;
+    connect(&watcher, &QFutureWatcher<QList<DocumentChange> >::progressValueChanged, &progress, &QProgressDialog::setValue);
+    connect(&watcher, &QFutureWatcher<QList<DocumentChange> >::finished, &loop, &QEventLoop::quit);
+    connect(&progress, &QProgressDialog::canceled, &watcher, &QFutureWatcher<QList<DocumentChange> >::cancel);
+    watcher.setFuture(future);
+    if (!future.isFinished())
+        loop.exec();
+    if (future.isCanceled())
+        return false;
+
+    foreach (const QList<DocumentChange>& fileChanges, future.results()) {
+        foreach (const DocumentChange& change, fileChanges) {
+            DocumentChangeSet::ChangeResult result = changes.addChange(change);
+            if (!result) {
+                KMessageBox::error(0, i18n("Applying changes failed: %1", result.m_failureReason));
+                return false;
+            }
+        }
+    }
+
+    DUChainReadLocker lock;
+    DocumentChangeSet::ChangeResult result = applyChangesToDeclarations(oldName, newName, changes, collector->declarations());
+    if (!result) {
+        lock.unlock();
+        KMessageBox::error(0, i18n("Applying changes failed: %1", result.m_failureReason));
+        return false;
+    }
+    return true;
+}
+
 DocumentChangeSet::ChangeResult SimpleRefactoring::applyChangesToDeclarations(
         const QString& oldName,
         const QString& newName,
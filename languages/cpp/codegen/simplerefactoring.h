@@ -61,6 +61,14 @@ private slots:
   void applyChangesDelayed();
 
 private:
+  /**
+   * Like BasicRefactoring::renameCollectedDeclarations, but the changes for the uses are collected
+   * from all using files in parallel, each file under its own read-lock, while a progress dialog is shown.
+   * @return false if the user cancelled, or the changes could not be added
+   */
+  bool renameCollectedDeclarationsInParallel(KDevelop::BasicRefactoringCollector* collector, const QString& newName,
+                                             const QString& oldName, KDevelop::DocumentChangeSet& changes);
+
   KDevelop::DocumentChangeSet m_pendingChanges;
 };
 
@@ -21,14 +21,37 @@
 #include <language/duchain/classdeclaration.h>
 #include "templatedeclaration.h"
 #include "typeutils.h"
+#include "topcontextrevisions.h"
 #include "debug.h"
 
+#include <QMutex>
+
 // uncomment to get debugging info on ADL - very expensive on parsing
 //#define DEBUG_ADL
 
 using namespace Cpp;
 using namespace KDevelop;
 
+namespace {
+///Caching more types than this for a single top-context is not worth the memory
+const int maxCachedTypesPerTopContext = 10000;
+///When this count of top-contexts is reached, the cache is cleared
+const int maxCachedTopContexts = 200;
+
+/**
+ * The associated namespaces of function argument types, memoized per top-context.
+ * They are valid as long as none of the top-contexts visible from the top-context was rebuilt.
+ */
+struct ADLCacheEntry
+{
+  TopContextRevisions::Snapshot imports;
+  QHash<IndexedType, QSet<QualifiedIdentifier> > namespaces;
+};
+
+QHash<uint, ADLCacheEntry> adlCache;
+QMutex adlCacheMutex;
+}
+
 ADLTypeVisitor::ADLTypeVisitor(ADLHelper & helper) : m_helper(helper)
 {
 }
@@ -174,7 +197,87 @@ ADLHelper::ADLHelper(DUContextPointer context, TopDUContextPointer topContext)
 void ADLHelper::addArgument(const OverloadResolver::Parameter & argument)
 {
     m_possibleFunctionName = argument.declaration;
-    addArgumentType(argument.type);
+
+    // the namespaces associated with a function name depend on the declaration and not only on its type,
+    // see ADLTypeVisitor::endVisit(const FunctionType *), so those are never taken from the cache
+    Declaration * possibleFunction = m_possibleFunctionName.data();
+    if (possibleFunction && possibleFunction->isFunctionDeclaration())
+        addArgumentType(argument.type);
+    else
+        addCachedArgumentType(argument.type);
+}
+
+void ADLHelper::addCachedArgumentType(const AbstractType::Ptr typePtr)
+{
+    if (!typePtr || !m_context || !m_topContext)
+    {
+        addArgumentType(typePtr);
+        return;
+    }
+
+    if(m_alreadyProcessed.contains(typePtr.data()))
+      return;
+
+    const IndexedType indexedType = typePtr->indexed();
+    const uint topContextIndex = m_topContext->ownIndex();
+    TopContextRevisions::Snapshot imports;
+    bool haveImports = false;
+
+    {
+        QMutexLocker lock(&adlCacheMutex);
+        QHash<uint, ADLCacheEntry>::iterator entry = adlCache.find(topContextIndex);
+        if (entry != adlCache.end() && !entry->imports.isCurrent())
+        {
+            adlCache.erase(entry);
+            entry = adlCache.end();
+        }
+        if (entry != adlCache.end())
+        {
+            QHash<IndexedType, QSet<QualifiedIdentifier> >::const_iterator it = entry->namespaces.constFind(indexedType);
+            if (it != entry->namespaces.constEnd())
+            {
+#ifdef DEBUG_ADL
+                qCDebug(CPPDUCHAIN) << "    using cached namespaces for argument type " << typePtr->toString();
+#endif
+                m_associatedNamespaces.unite(*it);
+                m_alreadyProcessed.insert(typePtr.data());
+                return;
+            }
+            imports = entry->imports;
+            haveImports = true;
+        }
+    }
+
+    // taken before computing, so a header rebuilt meanwhile makes the result invalid
+    if (!haveImports)
+        imports = TopContextRevisions::importClosure(m_topContext.data(), m_topContext.data());
+
+    // use a separate helper, so types seen through other arguments don't leave holes in the memoized set
+    ADLHelper helper(m_context, m_topContext);
+    helper.addArgumentType(typePtr);
+    m_associatedNamespaces.unite(helper.m_associatedNamespaces);
+    m_alreadyProcessed.insert(typePtr.data());
+
+    QMutexLocker lock(&adlCacheMutex);
+    if (!imports.isCurrent())
+        return;
+    QHash<uint, ADLCacheEntry>::iterator entry = adlCache.find(topContextIndex);
+    if (entry == adlCache.end())
+    {
+        if (adlCache.size() >= maxCachedTopContexts)
+            adlCache.clear();
+        entry = adlCache.insert(topContextIndex, ADLCacheEntry());
+        entry->imports = imports;
+    }
+    if (entry->namespaces.size() >= maxCachedTypesPerTopContext)
+        entry->namespaces.clear();
+    entry->namespaces.insert(indexedType, helper.m_associatedNamespaces);
+}
+
+void ADLHelper::invalidateCache(const IndexedTopDUContext& topContext)
+{
+    QMutexLocker lock(&adlCacheMutex);
+    adlCache.remove(topContext.index());
 }
 
 void ADLHelper::addArgumentType(const AbstractType::Ptr typePtr)
@@ -23,6 +23,7 @@
 #include <QSet>
 #include "overloadresolution.h"
 #include <language/duchain/types/typesystem.h>
+#include <language/duchain/indexedtopducontext.h>
 
 namespace Cpp
 {
@@ -77,7 +78,7 @@ class ADLTypeVisitor : public KDevelop::TypeVisitor
  *
  * Already seen types/classes/function declarations are skipped by the ADLTypeVisitor object.
  */
-class ADLHelper
+class KDEVCPPDUCHAIN_EXPORT ADLHelper
 {
   public:
     /**
@@ -94,8 +95,23 @@ class ADLHelper
     /** @brief Retrieves the list of associated namespaces . */
     QSet<QualifiedIdentifier> associatedNamespaces() const;
 
+    /**
+     * @brief Drops all associated namespaces memoized from the perspective of the given top-context.
+     *
+     * Should be called whenever the top-context is rebuilt or deleted, to free the memory. Results that depend on
+     * rebuilt headers are dropped anyway, see TopContextRevisions.
+     */
+    static void invalidateCache(const IndexedTopDUContext& topContext);
+
   private:
 
+    /**
+     * @brief Adds a function argument type, re-using the associated namespaces memoized for it if possible.
+     *
+     * Only valid for function call arguments, not for template arguments.
+     */
+    void addCachedArgumentType(const AbstractType::Ptr type);
+
     /**
      * @brief Adds an associated class type and its associated classes.
      *
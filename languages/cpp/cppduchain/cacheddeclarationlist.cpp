@@ -0,0 +1,76 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "cacheddeclarationlist.h"
+
+#include <language/duchain/declaration.h>
+#include <language/duchain/indexeddeclaration.h>
+#include <language/duchain/localindexeddeclaration.h>
+#include <language/duchain/topducontext.h>
+
+#include <QHash>
+
+using namespace KDevelop;
+using namespace Cpp;
+
+CachedDeclarationList::CachedDeclarationList(const DeclarationList& declarations, const TopContextRevisions::Snapshot& imports)
+  : m_imports(imports)
+{
+  QHash<uint, uint> positionForTopContext;
+  m_entries.reserve(declarations.size());
+  foreach(const auto& decl, declarations) {
+    const IndexedDeclaration indexed(decl.first);
+    QHash<uint, uint>::const_iterator position = positionForTopContext.constFind(indexed.topContextIndex());
+    if(position == positionForTopContext.constEnd()) {
+      position = positionForTopContext.insert(indexed.topContextIndex(), m_topContexts.size());
+      m_topContexts << indexed.topContextIndex();
+    }
+
+    Entry entry;
+    entry.topContext = *position;
+    entry.localIndex = indexed.localIndex();
+    entry.depth = decl.second;
+    m_entries << entry;
+  }
+}
+
+bool CachedDeclarationList::resolve(DeclarationList& declarations) const
+{
+  if(!m_imports.isCurrent())
+    return false;
+
+  QVector<TopDUContext*> topContexts;
+  topContexts.reserve(m_topContexts.size());
+  foreach(uint index, m_topContexts) {
+    TopDUContext* top = IndexedTopDUContext(index).data();
+    if(!top)
+      return false;
+    topContexts << top;
+  }
+
+  declarations.clear();
+  declarations.reserve(m_entries.size());
+  foreach(const Entry& entry, m_entries) {
+    Declaration* decl = LocalIndexedDeclaration(entry.localIndex).data(topContexts[entry.topContext]);
+    if(!decl) {
+      declarations.clear();
+      return false;
+    }
+    declarations << qMakePair(decl, entry.depth);
+  }
+  return true;
+}
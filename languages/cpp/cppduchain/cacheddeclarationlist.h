@@ -0,0 +1,72 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CACHEDDECLARATIONLIST_H
+#define CACHEDDECLARATIONLIST_H
+
+#include <cppduchainexport.h>
+#include "topcontextrevisions.h"
+
+namespace Cpp {
+
+///How often a declaration cache could be used since the application was started
+struct DeclarationCacheStatistics {
+  DeclarationCacheStatistics() : hits(0), misses(0) {
+  }
+  uint hits;
+  uint misses;
+};
+
+/**
+ * A list of declarations with their depth, as returned by DUContext::allDeclarations, that is kept in a cache.
+ *
+ * The list is only handed out again while none of the top-contexts it was computed from were rebuilt. The declarations
+ * are stored by their local index within their top-context, so each top-context is looked up only once when the list is
+ * resolved, instead of once for every declaration.
+ */
+class KDEVCPPDUCHAIN_EXPORT CachedDeclarationList
+{
+  public:
+    typedef QList<QPair<KDevelop::Declaration*, int> > DeclarationList;
+
+    ///@p imports must have been taken before the declarations were collected
+    CachedDeclarationList(const DeclarationList& declarations, const TopContextRevisions::Snapshot& imports);
+
+    /**
+     * Stores the declarations in @p declarations and returns true if the list is still valid.
+     * Not thread-safe for the same list, a cache must only call it with its own mutex locked.
+     * @warning The DUChain must be read-locked
+     */
+    bool resolve(DeclarationList& declarations) const;
+
+  private:
+    struct Entry
+    {
+      ///Position of the top-context in m_topContexts
+      uint topContext;
+      uint localIndex;
+      int depth;
+    };
+
+    TopContextRevisions::Snapshot m_imports;
+    QVector<uint> m_topContexts;
+    QVector<Entry> m_entries;
+};
+
+}
+
+#endif // CACHEDDECLARATIONLIST_H
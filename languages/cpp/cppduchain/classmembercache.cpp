@@ -0,0 +1,91 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "classmembercache.h"
+#include "topcontextrevisions.h"
+
+#include <language/duchain/declaration.h>
+#include <language/duchain/topducontext.h>
+
+#include <QCache>
+#include <QMutex>
+
+using namespace KDevelop;
+using namespace Cpp;
+
+namespace {
+
+struct ClassMemberKey
+{
+  ///The declaration of the class, including the template instantiation the class-context belongs to
+  DeclarationId classDeclaration;
+  uint source;
+
+  bool operator==(const ClassMemberKey& rhs) const {
+    return classDeclaration == rhs.classDeclaration && source == rhs.source;
+  }
+};
+
+uint qHash(const ClassMemberKey& key)
+{
+  return key.classDeclaration.hash() * 31 + key.source;
+}
+
+///Count of classes the members are remembered for, the least recently used are dropped first
+const int maxCachedClasses = 2000;
+
+QCache<ClassMemberKey, CachedDeclarationList> classMemberCache(maxCachedClasses);
+ClassMemberCache::CacheStatistics classMemberCacheStatistics;
+QMutex classMemberCacheMutex;
+
+}
+
+QList<QPair<Declaration*, int> > ClassMemberCache::allMembers(DUContext* classContext, const TopDUContext* source)
+{
+  Declaration* classDeclaration = classContext->owner();
+  if(classContext->type() != DUContext::Class || !classDeclaration)
+    return classContext->allDeclarations(CursorInRevision::invalid(), source, false);
+
+  ClassMemberKey key;
+  key.classDeclaration = classDeclaration->id(true);
+  key.source = source ? source->ownIndex() : 0;
+
+  QList<QPair<Declaration*, int> > ret;
+  {
+    QMutexLocker lock(&classMemberCacheMutex);
+    CachedDeclarationList* cached = classMemberCache.object(key);
+    if(cached && cached->resolve(ret)) {
+      ++classMemberCacheStatistics.hits;
+      return ret;
+    }
+    ++classMemberCacheStatistics.misses;
+  }
+
+  //The class and its base-classes, without the contexts around them
+  const TopContextRevisions::Snapshot imports = TopContextRevisions::importsOf(classContext, source);
+  ret = classContext->allDeclarations(CursorInRevision::invalid(), source, false);
+
+  QMutexLocker lock(&classMemberCacheMutex);
+  classMemberCache.insert(key, new CachedDeclarationList(ret, imports));
+  return ret;
+}
+
+ClassMemberCache::CacheStatistics ClassMemberCache::cacheStatistics()
+{
+  QMutexLocker lock(&classMemberCacheMutex);
+  return classMemberCacheStatistics;
+}
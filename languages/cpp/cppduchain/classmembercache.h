@@ -0,0 +1,53 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CLASSMEMBERCACHE_H
+#define CLASSMEMBERCACHE_H
+
+#include <cppduchainexport.h>
+#include <language/duchain/ducontext.h>
+#include "cacheddeclarationlist.h"
+
+namespace Cpp {
+
+/**
+ * Remembers the flattened member lists of classes, including the members of all base-classes.
+ *
+ * Computing them walks the whole class hierarchy, which is expensive for deep hierarchies, and is needed
+ * again for every member-access completion on the same class. The lists are kept across completion requests
+ * until one of the top-contexts the class hierarchy is declared in is rebuilt, see TopContextRevisions.
+ * Each template instantiation is cached separately, since its members differ.
+ */
+class KDEVCPPDUCHAIN_EXPORT ClassMemberCache
+{
+  public:
+    /**
+     * Returns the same as classContext->allDeclarations(CursorInRevision::invalid(), source, false).
+     * Only class-contexts are cached, for other contexts this simply forwards to allDeclarations.
+     * @warning The DUChain must be read-locked
+     */
+    static QList<QPair<KDevelop::Declaration*, int> > allMembers(KDevelop::DUContext* classContext, const KDevelop::TopDUContext* source);
+
+    typedef DeclarationCacheStatistics CacheStatistics;
+
+    ///Returns how often the cached member lists could be used since the application was started
+    static CacheStatistics cacheStatistics();
+};
+
+}
+
+#endif // CLASSMEMBERCACHE_H
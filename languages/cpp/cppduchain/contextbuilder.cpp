@@ -33,6 +33,7 @@
 #include "parsesession.h"
 #include "name_compiler.h"
 #include "environmentmanager.h"
+#include "writelockstatistics.h"
 #include "expressionvisitor.h"
 
 #include "cppdebughelper.h"
@@ -124,7 +125,7 @@ void ContextBuilder::setComputeEmpty(bool empty)
 
 
 void ContextBuilder::createUserProblem(AST* node, QString text) {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     KDevelop::ProblemPointer problem(new KDevelop::Problem);
     problem->setDescription(text);
     problem->setSource(IProblem::DUChainBuilder);
@@ -133,7 +134,7 @@ void ContextBuilder::createUserProblem(AST* node, QString text) {
 }
 
 void ContextBuilder::addBaseType( KDevelop::BaseClassInstance base, BaseSpecifierAST *node ) {
-  DUChainWriteLocker lock(DUChain::lock());
+  TimedWriteLocker lock;
 
   addImportedContexts(); //Make sure the template-contexts are imported first, before any parent-class contexts.
 
@@ -258,7 +259,7 @@ void ContextBuilder::openPrefixContext(AST* ast, const QualifiedIdentifier& id,
   DUContext* import = prefix.first;
 
   if(import) {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     addImportedParentContextSafely(currentContext(), import);
   }
 }
@@ -303,7 +304,7 @@ KDevelop::TopDUContext* ContextBuilder::buildProxyContextFromContent(Cpp::Enviro
 
   TopDUContext* topLevelContext = 0;
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     topLevelContext = updateContext.data();
 
     CppDUContext<TopDUContext>* cppContext = 0;
@@ -347,7 +348,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   setCompilingContexts(true);
 
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     if(updateContext && (updateContext->parsingEnvironmentFile() && updateContext->parsingEnvironmentFile()->isProxyContext())) {
       qCDebug(CPPDUCHAIN) << "updating a context " << file->url().str() << " from a proxy-context to a content-context";
       updateContext->parsingEnvironmentFile()->setIsProxyContext(false);
@@ -356,7 +357,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
 
   ReferencedTopDUContext topLevelContext;
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     topLevelContext = updateContext;
 
     RangeInRevision topRange = RangeInRevision(CursorInRevision(0,0), CursorInRevision(INT_MAX, INT_MAX));
@@ -413,7 +414,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   if(m_computeEmpty)
   {
     //Empty the top-context, in case we're updating
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     topLevelContext->cleanIfNotEncountered(QSet<DUChainBase*>());
   }else{
     Q_ASSERT(node);
@@ -474,7 +475,7 @@ void ContextBuilder::visitEnumSpecifier(EnumSpecifierAST* node)
   openContext(node, DUContext::Enum, node->isClass ? node->name : 0 );
 
   if (!node->isClass) {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     currentContext()->setPropagateDeclarations(true);
   }
 
@@ -509,7 +510,7 @@ void ContextBuilder::visitClassSpecifier (ClassSpecifierAST *node)
 
     if ((kind == Token_union || id.isEmpty())) {
       //It's an unnamed union context, or an unnamed struct, propagate the declarations to the parent
-      DUChainWriteLocker lock(DUChain::lock());
+      TimedWriteLocker lock;
 
       if(kind == Token_enum || kind == Token_union || m_typeSpecifierWithoutInitDeclarators == node->start_token) {
         ///@todo Mark unions in the duchain in some way, instead of just representing them as a class
@@ -621,7 +622,7 @@ DUContext* ContextBuilder::openContextInternal(const KDevelop::RangeInRevision&
   DUContext* ret = ContextBuilderBase::openContextInternal(range, type, identifier);
 
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     static_cast<CppDUContext<DUContext>*>(ret)->deleteAllInstantiations();
   }
 
@@ -951,7 +952,7 @@ void ContextBuilder::visitDeclarator(DeclaratorAST *node) {
 void ContextBuilder::addImportedContexts()
 {
   if (compilingContexts() && !m_importedParentContexts.isEmpty()) {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
 
     foreach (const DUContext::Import& imported, m_importedParentContexts)
       if(DUContext* imp = imported.context(topContext()))
@@ -44,6 +44,7 @@
 #include "qtfunctiondeclaration.h"
 #include "cppeditorintegrator.h"
 #include "environmentmanager.h"
+#include "writelockstatistics.h"
 #include <language/duchain/classfunctiondeclaration.h>
 #include <language/duchain/functiondeclaration.h>
 #include <language/duchain/functiondefinition.h>
@@ -117,7 +118,7 @@ void DeclarationBuilder::visitTemplateParameter(TemplateParameterAST * ast) {
     else
       decl = openDeclaration<TemplateParameterDeclaration>(ast->parameter_declaration->declarator ? ast->parameter_declaration->declarator->id : 0, ast, Identifier(), false, !ast->parameter_declaration->declarator);
 
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     AbstractType::Ptr type = lastType();
     if( type.cast<CppTemplateParameterType>() ) {
       type.cast<CppTemplateParameterType>()->setDeclaration(decl);
@@ -212,7 +213,7 @@ void DeclarationBuilder::visitInitDeclarator(InitDeclaratorAST *node)
     parameter_is_initializer = true;
   }else if(!m_inFunctionDefinition && node->declarator && node->declarator->parameter_declaration_clause && node->declarator->id) {
     //Decide whether the parameter-declaration clause is valid
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     CursorInRevision pos = editor()->findPosition(node->start_token, CppEditorIntegrator::FrontEdge);
 
     QualifiedIdentifier id;
@@ -278,7 +279,7 @@ void DeclarationBuilder::handleRangeBasedFor(ExpressionAST* container, ForRangeD
 
     if (!listType) {
       // invalid type
-      DUChainWriteLocker lock;
+      TimedWriteLocker lock;
       m_lastDeclaration->setAbstractType(AbstractType::Ptr(0));
       return;
     }
@@ -319,7 +320,7 @@ void DeclarationBuilder::handleRangeBasedFor(ExpressionAST* container, ForRangeD
     }
 
     // step 2: set last type, but keep const&
-    DUChainWriteLocker lock;
+    TimedWriteLocker lock;
     if (elementType) {
       AbstractType::Ptr type = m_lastDeclaration->abstractType();
       elementType->setModifiers(type->modifiers());
@@ -428,12 +429,12 @@ void DeclarationBuilder::visitDeclarator (DeclaratorAST* node)
       editor()->parseSession()->mapAstDuChain(m_mappedNodes.top(), KDevelop::DeclarationPointer(decl));
 
     if (m_functionFlag == DeleteFunction) {
-      DUChainWriteLocker lock(DUChain::lock());
+      TimedWriteLocker lock;
       decl->setExplicitlyDeleted(true);
     }
 
     if( !m_functionDefinedStack.isEmpty() ) {
-        DUChainWriteLocker lock(DUChain::lock());
+        TimedWriteLocker lock;
         // don't overwrite isDefinition if that was already set (see openFunctionDeclaration)
         decl->setDeclarationIsDefinition( (bool)m_functionDefinedStack.top() );
     }
@@ -462,7 +463,7 @@ void DeclarationBuilder::visitDeclarator (DeclaratorAST* node)
   if (node->parameter_declaration_clause && !isFuncPtr) {
     if (!m_functionDefinedStack.isEmpty() && m_functionDefinedStack.top() && node->id) {
 
-      DUChainWriteLocker lock(DUChain::lock());
+      TimedWriteLocker lock;
       //We have to search for the fully qualified identifier, so we always get the correct class
       QualifiedIdentifier id = currentContext()->scopeIdentifier(false);
       QualifiedIdentifier id2;
@@ -559,41 +560,8 @@ TemplateDeclaration* DeclarationBuilder::findSpecializedFrom(Declaration* specia
   return 0;
 }
 
-template<class T>
-T* DeclarationBuilder::openDeclaration(NameAST* name, AST* rangeNode, const Identifier& customName, bool collapseRangeAtStart, bool collapseRangeAtEnd)
-{
-  DUChainWriteLocker lock(DUChain::lock());
-
-  KDevelop::DUContext* templateCtx = hasTemplateContext(m_importedParentContexts + currentContext()->importedParentContexts(), topContext()).context(topContext());
-
-  ///We always need to create a template declaration when we're within a template, so the declaration can be accessed
-  ///by specialize(..) and its indirect DeclarationId
-  if( templateCtx || m_templateDeclarationDepth ) {
-    Cpp::SpecialTemplateDeclaration<T>* ret = openDeclarationReal<Cpp::SpecialTemplateDeclaration<T> >( name, rangeNode, customName, collapseRangeAtStart, collapseRangeAtEnd );
-    ret->setTemplateParameterContext(templateCtx);
-    //FIXME: A FunctionDeclaration w/o a definition should actually be a kind of forward declaration (ie, there can be more than one)
-    if( templateCtx && !m_onlyComputeSimplified && isSpecialization(ret) &&
-        ( dynamic_cast<FunctionDefinition*>(ret) || !dynamic_cast<FunctionDeclaration*>(ret) ) )
-    {
-      if( TemplateDeclaration *specializedFrom = findSpecializedFrom(ret) )
-      {
-        TemplateDeclaration *templateDecl = dynamic_cast<TemplateDeclaration*>(ret);
-         IndexedInstantiationInformation specializedWith = createSpecializationInformation(name, templateCtx);
-        templateDecl->setSpecializedFrom(specializedFrom);
-        templateDecl->setSpecializedWith(specializedWith);
-      }
-      //TODO: else problem
-    }
-    return ret;
-  } else{
-    return openDeclarationReal<T>( name, rangeNode, customName, collapseRangeAtStart, collapseRangeAtEnd );
-  }
-}
-
-template<class T>
-T* DeclarationBuilder::openDeclarationReal(NameAST* name, AST* rangeNode, const Identifier& customName, bool collapseRangeAtStart, bool collapseRangeAtEnd, const RangeInRevision* customRange)
+void DeclarationBuilder::prepareDeclaration(NameAST* name, AST* rangeNode, const Identifier& customName, bool collapseRangeAtStart, bool collapseRangeAtEnd, RangeInRevision& range, Identifier& localId)
 {
-  RangeInRevision newRange;
   if(name) {
     uint start = name->unqualified_name->start_token;
     uint end = name->unqualified_name->end_token;
@@ -604,19 +572,17 @@ T* DeclarationBuilder::openDeclarationReal(NameAST* name, AST* rangeNode, const
       start = name->unqualified_name->id;
     }
 
-    newRange = editor()->findRange(start, end);
+    range = editor()->findRange(start, end);
   }else if(rangeNode) {
-    newRange = editor()->findRange(rangeNode);
-  }else if(customRange) {
-    newRange = *customRange;
+    range = editor()->findRange(rangeNode);
   }
 
   if(collapseRangeAtStart)
-    newRange.end = newRange.start;
+    range.end = range.start;
   else if(collapseRangeAtEnd)
-    newRange.start = newRange.end;
+    range.start = range.end;
 
-  Identifier localId = customName;
+  localId = customName;
 
   if (name) {
     //If this is an operator thing, build the type first. Since it's part of the name, the type-builder doesn't catch it normally
@@ -629,7 +595,47 @@ T* DeclarationBuilder::openDeclarationReal(NameAST* name, AST* rangeNode, const
     if(localId.isEmpty())
       localId = id.last();
   }
+}
+
+template<class T>
+T* DeclarationBuilder::openDeclaration(NameAST* name, AST* rangeNode, const Identifier& customName, bool collapseRangeAtStart, bool collapseRangeAtEnd)
+{
+  //Computing the range and the identifier does not need the write-lock, so it is done before taking it
+  RangeInRevision newRange;
+  Identifier localId;
+  prepareDeclaration(name, rangeNode, customName, collapseRangeAtStart, collapseRangeAtEnd, newRange, localId);
+
+  TimedWriteLocker lock;
+
+  KDevelop::DUContext* templateCtx = hasTemplateContext(m_importedParentContexts + currentContext()->importedParentContexts(), topContext()).context(topContext());
+
+  ///We always need to create a template declaration when we're within a template, so the declaration can be accessed
+  ///by specialize(..) and its indirect DeclarationId
+  if( templateCtx || m_templateDeclarationDepth ) {
+    Cpp::SpecialTemplateDeclaration<T>* ret = openDeclarationReal<Cpp::SpecialTemplateDeclaration<T> >( newRange, localId );
+    ret->setTemplateParameterContext(templateCtx);
+    //FIXME: A FunctionDeclaration w/o a definition should actually be a kind of forward declaration (ie, there can be more than one)
+    if( templateCtx && !m_onlyComputeSimplified && isSpecialization(ret) &&
+        ( dynamic_cast<FunctionDefinition*>(ret) || !dynamic_cast<FunctionDeclaration*>(ret) ) )
+    {
+      if( TemplateDeclaration *specializedFrom = findSpecializedFrom(ret) )
+      {
+        TemplateDeclaration *templateDecl = dynamic_cast<TemplateDeclaration*>(ret);
+         IndexedInstantiationInformation specializedWith = createSpecializationInformation(name, templateCtx);
+        templateDecl->setSpecializedFrom(specializedFrom);
+        templateDecl->setSpecializedWith(specializedWith);
+      }
+      //TODO: else problem
+    }
+    return ret;
+  } else{
+    return openDeclarationReal<T>( newRange, localId );
+  }
+}
 
+template<class T>
+T* DeclarationBuilder::openDeclarationReal(const RangeInRevision& newRange, const Identifier& localId)
+{
   T* declaration = 0;
 
   if (recompiling()) {
@@ -717,7 +723,7 @@ ClassDeclaration* DeclarationBuilder::openClassDefinition(NameAST* name, AST* ra
   }
 
   ClassDeclaration* ret = openDeclaration<ClassDeclaration>(name, range, id, collapseRange);
-  DUChainWriteLocker lock(DUChain::lock());
+  TimedWriteLocker lock;
   ret->setDeclarationIsDefinition(true);
   ret->clearBaseClasses();
 
@@ -738,7 +744,7 @@ Declaration* DeclarationBuilder::openDefinition(NameAST* name, AST* rangeNode, b
   if(m_mapAst && !m_mappedNodes.empty())
     editor()->parseSession()->mapAstDuChain(m_mappedNodes.top(), KDevelop::DeclarationPointer(ret));
 
-  DUChainWriteLocker lock(DUChain::lock());
+  TimedWriteLocker lock;
   ret->setDeclarationIsDefinition(true);
   return ret;
 }
@@ -747,7 +753,7 @@ Declaration* DeclarationBuilder::openNormalDeclaration(NameAST* name, AST* range
   if(currentContext()->type() == DUContext::Class) {
     ClassMemberDeclaration* mem = openDeclaration<ClassMemberDeclaration>(name, rangeNode, customName, collapseRange);
 
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     mem->setAccessPolicy(currentAccessPolicy());
     return mem;
   } else if(currentContext()->type() == DUContext::Template) {
@@ -770,7 +776,7 @@ Declaration* DeclarationBuilder::openFunctionDeclaration(NameAST* name, AST* ran
    }
 
   if(currentContext()->type() == DUContext::Class) {
-    DUChainWriteLocker lock;
+    TimedWriteLocker lock;
     ClassFunctionDeclaration* fun = 0;
     if(!m_collectQtFunctionSignature) {
       fun = openDeclaration<ClassFunctionDeclaration>(name, rangeNode, localId);
@@ -791,7 +797,7 @@ Declaration* DeclarationBuilder::openFunctionDeclaration(NameAST* name, AST* ran
   } else if(m_inFunctionDefinition && (currentContext()->type() == DUContext::Namespace || currentContext()->type() == DUContext::Global)) {
     //May be a definition
      FunctionDefinition* ret = openDeclaration<FunctionDefinition>(name, rangeNode, localId);
-     DUChainWriteLocker lock(DUChain::lock());
+     TimedWriteLocker lock;
      ret->setDeclaration(0);
      return ret;
   }else{
@@ -801,7 +807,7 @@ Declaration* DeclarationBuilder::openFunctionDeclaration(NameAST* name, AST* ran
 
 void DeclarationBuilder::classTypeOpened(AbstractType::Ptr type) {
   //We override this so we can get the class-declaration into a usable state(with filled type) earlier
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
 
     IdentifiedType* idType = dynamic_cast<IdentifiedType*>(type.data());
 
@@ -814,7 +820,7 @@ void DeclarationBuilder::classTypeOpened(AbstractType::Ptr type) {
 void DeclarationBuilder::closeDeclaration(bool forceInstance)
 {
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
 
     if (lastType()) {
 
@@ -1000,14 +1006,14 @@ void DeclarationBuilder::visitEnumerator(EnumeratorAST* node)
   EnumeratorType::Ptr enumeratorType = lastType().cast<EnumeratorType>();
 
   if(ClassMemberDeclaration* classMember = dynamic_cast<ClassMemberDeclaration*>(currentDeclaration())) {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     classMember->setStatic(true);
   }
 
   closeDeclaration(true);
 
   if(enumeratorType) { ///@todo Move this into closeDeclaration in a logical way
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     enumeratorType->setDeclaration(decl);
     decl->setAbstractType(enumeratorType.cast<AbstractType>());
   }else if(!lastType().cast<DelayedType>()){ //If it's in a template, it may be DelayedType
@@ -1019,7 +1025,7 @@ void DeclarationBuilder::visitEnumerator(EnumeratorAST* node)
 void DeclarationBuilder::classContextOpened(ClassSpecifierAST* /*node*/, DUContext* context) {
 
   //We need to set this early, so we can do correct search while building
-  DUChainWriteLocker lock(DUChain::lock());
+  TimedWriteLocker lock;
   currentDeclaration()->setInternalContext(context);
 }
 
@@ -1040,9 +1046,9 @@ void DeclarationBuilder::visitNamespace(NamespaceAST* ast) {
       range.end = range.start;
     }
 
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
 
-    Declaration * declaration = openDeclarationReal<Declaration>(0, 0, id, false, false, &range);
+    Declaration * declaration = openDeclarationReal<Declaration>(range, id);
 
     ///Create mappings iff the AST feature is specified
     if(m_mapAst)
@@ -1053,7 +1059,7 @@ void DeclarationBuilder::visitNamespace(NamespaceAST* ast) {
 
   QualifiedIdentifier qid;
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     currentDeclaration()->setKind(KDevelop::Declaration::Namespace);
     qid = currentDeclaration()->qualifiedIdentifier();
     clearLastType();
@@ -1064,9 +1070,8 @@ void DeclarationBuilder::visitNamespace(NamespaceAST* ast) {
   // i.e. compare to visitUsingDirective()
   if( ast->inlined && compilingContexts() ) {
     RangeInRevision aliasRange(range.end + CursorInRevision(0, 1), 0);
-    DUChainWriteLocker lock;
-    NamespaceAliasDeclaration* decl = openDeclarationReal<NamespaceAliasDeclaration>(0, 0, globalImportIdentifier(), false, false,
-                                                                                     &aliasRange);
+    TimedWriteLocker lock;
+    NamespaceAliasDeclaration* decl = openDeclarationReal<NamespaceAliasDeclaration>(aliasRange, globalImportIdentifier());
     decl->setImportIdentifier( qid );
     closeDeclaration();
   }
@@ -1143,7 +1148,7 @@ void DeclarationBuilder::visitClassSpecifier(ClassSpecifierAST *node)
 
   if( node->name ) {
     ///Copy template default-parameters from the forward-declaration to the real declaration if possible
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     copyTemplateDefaultsFromForward(id.last(), pos);
   }
 
@@ -1164,7 +1169,7 @@ void DeclarationBuilder::visitBaseSpecifier(BaseSpecifierAST *node) {
 
   BaseClassInstance instance;
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
     ClassDeclaration* currentClass = dynamic_cast<ClassDeclaration*>(currentDeclaration());
     if(currentClass) {
 
@@ -1250,7 +1255,7 @@ void DeclarationBuilder::visitUsing(UsingAST * node)
   ///@todo only use the last name component as range
   AliasDeclaration* decl = openDeclaration<AliasDeclaration>(0, node->name ? (AST*)node->name : (AST*)node, id.last());
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
 
     CursorInRevision pos = editor()->findPosition(node->start_token, CppEditorIntegrator::FrontEdge);
     QList<Declaration*> declarations = currentContext()->findDeclarations(id, pos);
@@ -1275,13 +1280,12 @@ void DeclarationBuilder::visitUsingDirective(UsingDirectiveAST * node)
 
   if( compilingContexts() ) {
     RangeInRevision range = editor()->findRange(node->start_token);
-    DUChainWriteLocker lock(DUChain::lock());
-    NamespaceAliasDeclaration* decl = openDeclarationReal<NamespaceAliasDeclaration>(0, 0, globalImportIdentifier(), false, false, &range);
-    {
-      QualifiedIdentifier id;
-      identifierForNode(node->name, id);
-      decl->setImportIdentifier( resolveNamespaceIdentifier(id, currentDeclaration()->range().start) );
-    }
+    QualifiedIdentifier id;
+    identifierForNode(node->name, id);
+
+    TimedWriteLocker lock;
+    NamespaceAliasDeclaration* decl = openDeclarationReal<NamespaceAliasDeclaration>(range, globalImportIdentifier());
+    decl->setImportIdentifier( resolveNamespaceIdentifier(id, currentDeclaration()->range().start) );
     closeDeclaration();
   }
 }
@@ -1319,13 +1323,12 @@ void DeclarationBuilder::visitNamespaceAliasDefinition(NamespaceAliasDefinitionA
 
   if( compilingContexts() ) {
     RangeInRevision range = editor()->findRange(node->namespace_name);
-    DUChainWriteLocker lock(DUChain::lock());
-    NamespaceAliasDeclaration* decl = openDeclarationReal<NamespaceAliasDeclaration>(0, 0, Identifier(editor()->parseSession()->token_stream->symbol(node->namespace_name)), false, false, &range);
-    {
-      QualifiedIdentifier id;
-      identifierForNode(node->alias_name, id);
-      decl->setImportIdentifier( resolveNamespaceIdentifier(id, currentDeclaration()->range().start) );
-    }
+    QualifiedIdentifier id;
+    identifierForNode(node->alias_name, id);
+
+    TimedWriteLocker lock;
+    NamespaceAliasDeclaration* decl = openDeclarationReal<NamespaceAliasDeclaration>(range, Identifier(editor()->parseSession()->token_stream->symbol(node->namespace_name)));
+    decl->setImportIdentifier( resolveNamespaceIdentifier(id, currentDeclaration()->range().start) );
     closeDeclaration();
   }
 }
@@ -1429,7 +1432,7 @@ void DeclarationBuilder::visitElaboratedTypeSpecifier(ElaboratedTypeSpecifierAST
   DeclarationBuilderBase::visitElaboratedTypeSpecifier(node);
 
   if (openedDeclaration) {
-/*    DUChainWriteLocker lock(DUChain::lock());
+/*    TimedWriteLocker lock;
     //Resolve forward-declarations that are declared after the real type was already declared
     Q_ASSERT(dynamic_cast<ForwardDeclaration*>(currentDeclaration()));
     IdentifiedType* idType = dynamic_cast<IdentifiedType*>(lastType().data());
@@ -1569,7 +1572,7 @@ void DeclarationBuilder::visitParameterDeclaration(ParameterDeclarationAST* node
   if( function ) {
 
     if( node->expression ) {
-      DUChainWriteLocker lock(DUChain::lock());
+      TimedWriteLocker lock;
       //Fill default-parameters
       QString defaultParam = stringFromSessionTokens( editor()->parseSession(), node->expression->start_token, node->expression->end_token ).trimmed();
 
@@ -1596,7 +1599,7 @@ void DeclarationBuilder::applyStorageSpecifiers()
 {
   if (!m_storageSpecifiers.isEmpty() && m_storageSpecifiers.top() != 0)
     if (ClassMemberDeclaration* member = dynamic_cast<ClassMemberDeclaration*>(currentDeclaration())) {
-      DUChainWriteLocker lock(DUChain::lock());
+      TimedWriteLocker lock;
 
       member->setStorageSpecifiers(m_storageSpecifiers.top());
     }
@@ -1634,7 +1637,7 @@ void DeclarationBuilder::inheritVirtualSpecifierFromOverridden(ClassFunctionDecl
 
 void DeclarationBuilder::applyFunctionSpecifiers()
 {
-  DUChainWriteLocker lock(DUChain::lock());
+  TimedWriteLocker lock;
   AbstractFunctionDeclaration* function = dynamic_cast<AbstractFunctionDeclaration*>(currentDeclaration());
   if(!function)
     return;
@@ -1732,7 +1735,7 @@ bool DeclarationBuilder::checkParameterDeclarationClause(ParameterDeclarationCla
 void DeclarationBuilder::eventuallyAssignInternalContext()
 {
   if (TypeBuilder::lastContext()) {
-    DUChainWriteLocker lock(DUChain::lock());
+    TimedWriteLocker lock;
 
     if( dynamic_cast<ClassFunctionDeclaration*>(currentDeclaration()) )
       Q_ASSERT( !static_cast<ClassFunctionDeclaration*>(currentDeclaration())->isConstructor() || currentDeclaration()->context()->type() == DUContext::Class );
@@ -121,8 +121,12 @@ private:
    */
   template<class T>
   T* openDeclaration(NameAST* name, AST* range, const Identifier& customName = Identifier(), bool collapseRange = false, bool collapseRangeAtEnd = false);
+  ///Opens a declaration with the given range and identifier, or re-uses a matching one. The DUChain must be write-locked.
   template<class T>
-  T* openDeclarationReal(NameAST* name, AST* range, const Identifier& customName, bool collapseRangeAtStart, bool collapseRangeAtEnd, const RangeInRevision* customRange = 0);
+  T* openDeclarationReal(const RangeInRevision& range, const Identifier& localId);
+  ///Computes the range and the local identifier of a declaration for openDeclaration(). Must be called without the DUChain locked.
+  void prepareDeclaration(NameAST* name, AST* rangeNode, const Identifier& customName, bool collapseRangeAtStart, bool collapseRangeAtEnd,
+                          RangeInRevision& range, Identifier& localId);
   /// Same as the above, but sets it as the definition too @param forceInstance when this is true, the declaration is forced to be an instance, not a type declaration,
   /// and its assigned identified type will not get the declaration assigned.
   virtual void closeDeclaration(bool forceInstance = false);
@@ -0,0 +1,87 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "documentsnapshot.h"
+
+#include <language/duchain/topducontext.h>
+
+#include "environmentmanager.h"
+
+#include <QMutex>
+
+using namespace KDevelop;
+using namespace Cpp;
+
+namespace {
+
+QHash<IndexedString, DocumentSnapshot::Ptr> documentSnapshots;
+QMutex documentSnapshotsMutex;
+
+void addMacros(const ReferenceCountedMacroSet& macros, QSet<IndexedString>& names)
+{
+  for(ReferenceCountedMacroSet::Iterator it = macros.iterator(); it; ++it) {
+    const rpp::pp_macro& macro = *it;
+    if(!macro.isUndef())
+      names.insert(macro.name);
+  }
+}
+
+}
+
+DocumentSnapshot::Ptr DocumentSnapshot::forDocument(const IndexedString& document)
+{
+  QMutexLocker lock(&documentSnapshotsMutex);
+  return documentSnapshots.value(document);
+}
+
+void DocumentSnapshot::publish(const TopDUContext* contentContext, const TopDUContext* standardContext)
+{
+  if(!contentContext)
+    return;
+
+  QSharedPointer<DocumentSnapshot> snapshot(new DocumentSnapshot);
+
+  foreach(const DUContext::Import& import, contentContext->importedParentContexts()) {
+    DUContext* imported = import.context(0);
+    if(!imported)
+      continue;
+    const int line = contentContext->transformFromLocalRevision(contentContext->importPosition(imported)).line();
+    //As when searching the imports directly, the first include on a line wins
+    if(!snapshot->includes.contains(line))
+      snapshot->includes.insert(line, imported->topContext()->indexed());
+  }
+
+  if(!standardContext)
+    standardContext = contentContext;
+  const EnvironmentFile* file = dynamic_cast<const EnvironmentFile*>(standardContext->parsingEnvironmentFile().data());
+  if(file) {
+    addMacros(file->usedMacros(), snapshot->macros);
+    addMacros(file->definedMacros(), snapshot->macros);
+  }
+
+  const IndexedString document = contentContext->url();
+  QMutexLocker lock(&documentSnapshotsMutex);
+  Ptr& current = documentSnapshots[document];
+  snapshot->version = current ? current->version + 1 : 1;
+  current = snapshot;
+}
+
+void DocumentSnapshot::remove(const IndexedString& document)
+{
+  QMutexLocker lock(&documentSnapshotsMutex);
+  documentSnapshots.remove(document);
+}
@@ -0,0 +1,71 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef DOCUMENTSNAPSHOT_H
+#define DOCUMENTSNAPSHOT_H
+
+#include <cppduchainexport.h>
+#include <language/duchain/indexedtopducontext.h>
+#include <serialization/indexedstring.h>
+
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+
+namespace KDevelop {
+  class TopDUContext;
+}
+
+namespace Cpp {
+
+/**
+ * An immutable summary of the last parse of a document, for the queries the editor does on the UI thread
+ * while the mouse moves, so they do not have to wait for the DUChain lock while a background parse writes.
+ *
+ * A new snapshot is published after each parse of an open document, and replaces the previous one.
+ * Users that still hold the previous one keep a consistent view of it. The lines are those of the document
+ * revision at the time of the parse, so they can be slightly behind while the document is edited.
+ */
+class KDEVCPPDUCHAIN_EXPORT DocumentSnapshot
+{
+  public:
+    typedef QSharedPointer<const DocumentSnapshot> Ptr;
+
+    ///Increased with every snapshot published for the document
+    uint version;
+    ///The files included by the document, by the line of the #include
+    QHash<int, KDevelop::IndexedTopDUContext> includes;
+    ///The names of all macros that are used or defined in the document, and are not undefs
+    QSet<KDevelop::IndexedString> macros;
+
+    ///Returns the snapshot of the last parse of the document, or a null pointer if there is none
+    static Ptr forDocument(const KDevelop::IndexedString& document);
+
+    /**
+     * Publishes a new snapshot for the document of @p contentContext.
+     * @param standardContext The context whose environment-file the macros are taken from, the proxy-context if there is one
+     * @warning The DUChain must be read-locked
+     */
+    static void publish(const KDevelop::TopDUContext* contentContext, const KDevelop::TopDUContext* standardContext);
+
+    ///Drops the snapshot of the document, for example because it was closed
+    static void remove(const KDevelop::IndexedString& document);
+};
+
+}
+
+#endif // DOCUMENTSNAPSHOT_H
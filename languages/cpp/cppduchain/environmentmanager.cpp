@@ -12,7 +12,11 @@
  ***************************************************************************/
 
 #include "environmentmanager.h"
+#include <QCache>
+#include <QCryptographicHash>
+#include <QFile>
 #include <QFileInfo>
+#include <QSet>
 #include "rpp/pp-macro.h"
 #include "rpp/pp-environment.h"
 #include <language/duchain/problem.h>
@@ -176,9 +180,11 @@ QString print(const Cpp::ReferenceCountedMacroSet& set) {
 
 EnvironmentManager* EnvironmentManager::m_self = 0;
 
+//The macro repository is at version 2 since the macro definitions are shared through the macro-body repository,
+//and at version 3 since the environment-files store a content hash. Bumping it clears the stored environment-files too.
 EnvironmentManager::EnvironmentManager()
   : m_matchingLevel(Full), m_simplifiedMatching(false),
-    m_macroDataRepository("macro repository"), m_stringSetRepository("string sets"), m_macroSetRepository()
+    m_macroDataRepository("macro repository", &globalItemRepositoryRegistry(), 3), m_stringSetRepository("string sets"), m_macroSetRepository()
 {
 }
 
@@ -200,15 +206,24 @@ void Cpp::EnvironmentManager::setMatchingLevel(Cpp::EnvironmentManager::Matching
 }
 
 bool EnvironmentFile::matchEnvironment(const ParsingEnvironment* _environment) const {
+  return matchEnvironment(_environment, 0);
+}
+
+bool EnvironmentFile::matchEnvironment(const ParsingEnvironment* _environment, QString* mismatch) const {
   ENSURE_READ_LOCKED
   const CppPreprocessEnvironment* cppEnvironment = dynamic_cast<const CppPreprocessEnvironment*>(_environment);
-  if(!cppEnvironment)
+  if(!cppEnvironment) {
+    if(mismatch)
+      *mismatch = QStringLiteral("not a C++ environment");
     return false;
+  }
 
   if( cppEnvironment->identityOffsetRestrictionEnabled() && cppEnvironment->identityOffsetRestriction() != identityOffset() ) {
 #ifdef DEBUG_LEXERCACHE
     qCDebug(CPPDUCHAIN) << "file" << url().str() << "does not match branching hash. Restriction:" << cppEnvironment->identityOffsetRestriction() << "Actual:" << identityOffset();
 #endif
+    if(mismatch)
+      *mismatch = QStringLiteral("different branching in the header-section");
     return false;
   }
 
@@ -240,6 +255,8 @@ bool EnvironmentFile::matchEnvironment(const ParsingEnvironment* _environment) c
         qCDebug(CPPDUCHAIN) << "The environment contains a macro that can affect the cached file, but that should not exist:" << m.name.str();
       }
 #endif
+      if(mismatch)
+        *mismatch = QStringLiteral("macro %1 is defined").arg(m.name.str());
       return false;
     }
   }
@@ -261,6 +278,8 @@ bool EnvironmentFile::matchEnvironment(const ParsingEnvironment* _environment) c
       } else {
         ifDebug( qCDebug(CPPDUCHAIN) << "The cached file " << url().str() << " used a macro called \"" << macro.name.str() << "\"(from" << macro.file.str() << "), but the environment" << (m ? "contains differing macro of that name" : "does not contain that macro") << ", the cached file is not used"  );
         ifDebug( if(m) { qCDebug(CPPDUCHAIN) << "Used macro: " << macro.toString()  << "from" << macro.file.str() << "found:" << m->toString() << "from" << m->file.str(); } );
+        if(mismatch)
+          *mismatch = (m.isValid() ? QStringLiteral("macro %1 differs") : QStringLiteral("macro %1 is missing")).arg(macro.name.str());
         return false;
       }
     }else{
@@ -284,7 +303,104 @@ void Cpp::EnvironmentFile::setIncludePathDependencies(const KDevelop::Modificati
   d_func_dynamic()->m_includePathDependencies = set;
 }
 
+namespace {
+
+struct DiskContentHash {
+  ModificationRevision revision;
+  quint64 hash;
+};
+
+///Count of files the disk contents hash is remembered for, the least recently used are dropped first
+const int maxCachedDiskContentHashes = 20000;
+
+QCache<IndexedString, DiskContentHash> diskContentHashes(maxCachedDiskContentHashes);
+QMutex diskContentHashesMutex;
+
+///Whether the hash of the contents the file has on disk at @p revision is known. If it is, it is stored in @p hash.
+bool cachedDiskContentHash(const IndexedString& url, const ModificationRevision& revision, quint64* hash)
+{
+  QMutexLocker lock(&diskContentHashesMutex);
+  const DiskContentHash* cached = diskContentHashes.object(url);
+  if(!cached || cached->revision != revision)
+    return false;
+  *hash = cached->hash;
+  return true;
+}
+
+///A file that was touched since it was parsed, but whose contents did not change
+struct TouchedFile {
+  IndexedString url;
+  ModificationRevision parsed;
+  ModificationRevision current;
+};
+
+///Environment-files whose modification-revisions can be refreshed, see EnvironmentFile::refreshTouchedRevisions()
+struct PendingRefresh {
+  ParsingEnvironmentFilePointer file;
+  QVector<TouchedFile> touched;
+};
+
+QHash<const ParsingEnvironmentFile*, PendingRefresh> pendingRefreshes;
+QMutex pendingRefreshesMutex;
+
+struct ContentCheck {
+  ContentCheck() : unhashedFiles(0), unknown(false) {
+  }
+  QSet<uint> visited;
+  QVector<TouchedFile> touched;
+  QList<IndexedString>* unhashedFiles;
+  ///Whether a touched file was not hashed yet, so it is not known whether its contents changed
+  bool unknown;
+};
+
+///Whether the contents of @p file or of one of its recursive imports differ from the ones they were parsed from.
+///The DUChain must be read-locked. Files are never read here, only their cached hashes are compared.
+bool contentsChanged(const ParsingEnvironmentFile* file, ContentCheck& check)
+{
+  const uint topContext = file->indexedTopContext().index();
+  if(check.visited.contains(topContext))
+    return false;
+  check.visited.insert(topContext);
+
+  const ModificationRevision current = ModificationRevision::revisionForFile(file->url());
+  if(current != file->modificationRevision()) {
+    const EnvironmentFile* cppFile = dynamic_cast<const EnvironmentFile*>(file);
+    //Changes within an open document cannot be compared to the disk contents
+    if(!cppFile || !cppFile->contentHash() || current.revision != file->modificationRevision().revision)
+      return true;
+
+    quint64 diskHash;
+    if(!cachedDiskContentHash(file->url(), current, &diskHash)) {
+      check.unknown = true;
+      if(!check.unhashedFiles)
+        return true;
+      *check.unhashedFiles << file->url();
+    }else if(diskHash != cppFile->contentHash()) {
+      return true;
+    }else{
+      ifDebug( qCDebug(CPPDUCHAIN) << file->url().str() << "was touched, but its contents did not change"; )
+      TouchedFile touched;
+      touched.url = file->url();
+      touched.parsed = file->modificationRevision();
+      touched.current = current;
+      check.touched << touched;
+    }
+  }
+
+  foreach(const ParsingEnvironmentFilePointer& import, file->imports())
+    if(import && contentsChanged(import.data(), check))
+      return true;
+
+  return false;
+}
+
+}
+
 bool EnvironmentFile::needsUpdate(const ParsingEnvironment* environment) const {
+  return needsUpdate(environment, 0);
+}
+
+bool EnvironmentFile::needsUpdate(const ParsingEnvironment* environment, QList<IndexedString>* unhashedFiles) const {
   ENSURE_READ_LOCKED
   const CppPreprocessEnvironment* cppEnvironment = dynamic_cast<const CppPreprocessEnvironment*>(environment);
 
@@ -293,7 +409,96 @@ bool EnvironmentFile::needsUpdate(const ParsingEnvironment* environment) const {
   if(cppEnvironment && EnvironmentManager::self()->matchingLevel() <= EnvironmentManager::Naive && !headerGuard().isEmpty() && cppEnvironment->macroNameSet().contains(headerGuard()))
     return false;
 
-  return ParsingEnvironmentFile::needsUpdate(environment) || d_func()->m_includePathDependencies.needsUpdate();
+  if(d_func()->m_includePathDependencies.needsUpdate())
+    return true;
+
+  if(!ParsingEnvironmentFile::needsUpdate(environment))
+    return false;
+
+  //Some modification-times changed. Switching branches touches many files without changing their contents,
+  //so only update when the contents really changed.
+  ContentCheck check;
+  check.unhashedFiles = unhashedFiles;
+  if(contentsChanged(this, check) || check.unknown)
+    return true;
+
+  if(check.touched.isEmpty())
+    return false;
+
+  //Remember the new modification-revisions, so the contents are not compared again on every check
+  QMutexLocker lock(&pendingRefreshesMutex);
+  PendingRefresh& refresh(pendingRefreshes[this]);
+  refresh.file = ParsingEnvironmentFilePointer(const_cast<EnvironmentFile*>(this));
+  refresh.touched = check.touched;
+  return false;
+}
+
+void EnvironmentFile::hashFilesOnDisk(const QList<IndexedString>& files) {
+  foreach(const IndexedString& url, files) {
+    DiskContentHash* entry = new DiskContentHash;
+    entry->revision = ModificationRevision::revisionForFile(url);
+    //Unreadable files get the hash zero, which matches no stored hash
+    entry->hash = 0;
+    QFile file(url.str());
+    if(file.open(QIODevice::ReadOnly))
+      entry->hash = hashContents(file.readAll());
+
+    QMutexLocker lock(&diskContentHashesMutex);
+    diskContentHashes.insert(url, entry);
+  }
+}
+
+void EnvironmentFile::refreshTouchedRevisions() {
+  QList<PendingRefresh> refreshes;
+  {
+    QMutexLocker lock(&pendingRefreshesMutex);
+    refreshes = pendingRefreshes.values();
+    pendingRefreshes.clear();
+  }
+  if(refreshes.isEmpty())
+    return;
+
+  DUChainWriteLocker lock(DUChain::lock());
+  foreach(const PendingRefresh& refresh, refreshes) {
+    ParsingEnvironmentFile* file = refresh.file.data();
+    ModificationRevisionSet revisions = file->allModificationRevisions();
+    ModificationRevision own = file->modificationRevision();
+    foreach(const TouchedFile& touched, refresh.touched) {
+      //Skip files that were touched again, and environment-files that were rebuilt meanwhile
+      if(ModificationRevision::revisionForFile(touched.url) != touched.current || !revisions.removeModificationRevision(touched.url, touched.parsed))
+        continue;
+      revisions.addModificationRevision(touched.url, touched.current);
+      if(touched.url == file->url() && own == touched.parsed)
+        own = touched.current;
+    }
+
+    //setModificationRevision() also adds the own revision to the set, which already contains it
+    file->clearModificationRevisions();
+    file->setModificationRevision(own);
+    file->addModificationRevisions(revisions);
+  }
+  //The references are released with the lock held
+  refreshes.clear();
+}
+
+quint64 EnvironmentFile::contentHash() const {
+  ENSURE_READ_LOCKED
+  return d_func()->m_contentHash;
+}
+
+void EnvironmentFile::setContentHash(quint64 hash) {
+  ENSURE_WRITE_LOCKED
+  d_func_dynamic()->m_contentHash = hash;
+}
+
+quint64 EnvironmentFile::hashContents(const QByteArray& contents) {
+  //The hash is stored on disk, so it must be the same in every build and every process, which qHash() does not guarantee.
+  //The first 64 bits of the SHA-1 make accidental matches between different contents very unlikely.
+  const QByteArray sha1 = QCryptographicHash::hash(contents, QCryptographicHash::Sha1);
+  quint64 ret = 0;
+  for(int a = 0; a < 8; ++a)
+    ret = (ret << 8) | quint8(sha1[a]);
+  return ret;
 }
 
 EnvironmentFile::EnvironmentFile( const IndexedString& url, TopDUContext* topContext ) : ParsingEnvironmentFile(*new EnvironmentFileData(), url) {
@@ -161,6 +161,7 @@ public:
 //       m_includeFiles = 0;
       m_identityOffset = 0;
       m_includePaths = 0;
+      m_contentHash = 0;
     }
     EnvironmentFileData(const EnvironmentFileData& rhs) : KDevelop::ParsingEnvironmentFileData(rhs) {
       m_url = rhs.m_url;
@@ -178,6 +179,7 @@ public:
       m_includePaths = rhs.m_includePaths;
       m_guard = rhs.m_guard;
       m_includePathDependencies = rhs.m_includePathDependencies;
+      m_contentHash = rhs.m_contentHash;
     }
     
     ~EnvironmentFileData() {
@@ -200,6 +202,9 @@ public:
     KDevelop::IndexedString m_guard;
     
     KDevelop::ModificationRevisionSet m_includePathDependencies;
+
+    //Hash of the raw file contents that were parsed, zero if unknown
+    quint64 m_contentHash;
 };
 
 class KDEVCPPDUCHAIN_EXPORT EnvironmentFile : public KDevelop::ParsingEnvironmentFile {
@@ -282,8 +287,37 @@ class KDEVCPPDUCHAIN_EXPORT EnvironmentFile : public KDevelop::ParsingEnvironmen
     uint identityOffset() const;
     
     virtual bool matchEnvironment(const KDevelop::ParsingEnvironment* environment) const override;
+
+    ///Same as matchEnvironment(), and if it does not match, stores the reason into @p mismatch, for example the macro that differs
+    bool matchEnvironment(const KDevelop::ParsingEnvironment* environment, QString* mismatch) const;
     
+    /**
+     * Only returns true if the contents of this file or of one of the recursively included files changed.
+     * When only the modification-times changed, for example by switching branches, the hashes of the contents
+     * on disk are compared to the content hashes stored while parsing.
+     *
+     * Files are not read here, since the DUChain is locked. A touched file whose contents were not hashed yet,
+     * see hashFilesOnDisk(), counts as changed.
+     * */
     virtual bool needsUpdate(const KDevelop::ParsingEnvironment* environment = 0) const override;
+
+    ///Same as needsUpdate(), but stores the touched files whose contents were not hashed yet in @p unhashedFiles
+    bool needsUpdate(const KDevelop::ParsingEnvironment* environment, QList<KDevelop::IndexedString>* unhashedFiles) const;
+
+    ///Hashes the contents the given files have on disk, for needsUpdate(). Must be called without the DUChain locked.
+    static void hashFilesOnDisk(const QList<KDevelop::IndexedString>& files);
+
+    /**
+     * Stores the current modification-revisions of the touched but unchanged files found by needsUpdate(), so their
+     * contents are not compared again. Locks the DUChain for writing, so it must be called without the DUChain locked.
+     * */
+    static void refreshTouchedRevisions();
+
+    ///Hash of the raw file contents this environment-file was built from, as computed by hashContents(), or zero if unknown
+    quint64 contentHash() const;
+    void setContentHash(quint64 hash);
+
+    static quint64 hashContents(const QByteArray& contents);
     
     const KDevelop::ModificationRevisionSet& includePathDependencies() const;
     void  setIncludePathDependencies(const KDevelop::ModificationRevisionSet&);
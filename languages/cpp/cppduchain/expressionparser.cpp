@@ -33,9 +33,13 @@
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/identifier.h>
 #include "expressionvisitor.h"
+#include "topcontextrevisions.h"
 #include "debug.h"
 #include <parser/rpp/chartools.h>
 
+#include <QCache>
+#include <QMutex>
+
 
 namespace Cpp {
 using namespace KDevelop;
@@ -107,6 +111,51 @@ QHash<QByteArray, ExpressionEvaluationResult> buildStaticLookupTable()
   return ret;
 }
 
+namespace {
+///Identifies the evaluation of one expression string, the results of which can be re-used
+struct ExpressionCacheKey
+{
+  QByteArray expression;
+  IndexedDUContext context;
+  uint sourceTopContext;
+  ///Whether the expression was forced, and the flags of the expression-parser that influence the result
+  uint flags;
+
+  bool operator==(const ExpressionCacheKey& rhs) const {
+    return expression == rhs.expression && context == rhs.context && sourceTopContext == rhs.sourceTopContext && flags == rhs.flags;
+  }
+};
+
+uint qHash(const ExpressionCacheKey& key)
+{
+  return (qHash(key.expression) * 31 + key.context.hash()) * 17 + key.sourceTopContext * 7 + key.flags;
+}
+
+struct CachedExpression
+{
+  ///The top-contexts visible from the context at the time the expression was evaluated
+  TopContextRevisions::Snapshot imports;
+  ExpressionEvaluationResult result;
+};
+
+///Count of evaluated expressions that are remembered, the least recently used are dropped first
+const int maxCachedExpressions = 2000;
+///Count of contexts the import-closure is remembered for
+const int maxCachedContextImports = 200;
+
+QCache<ExpressionCacheKey, CachedExpression> expressionCache(maxCachedExpressions);
+///The import-closures of the contexts expressions were recently evaluated in, keyed like the expressions without expression and flags
+QCache<ExpressionCacheKey, TopContextRevisions::Snapshot> expressionContextImports(maxCachedContextImports);
+ExpressionParser::CacheStatistics expressionCacheStatistics;
+QMutex expressionCacheMutex;
+}
+
+ExpressionParser::CacheStatistics ExpressionParser::cacheStatistics()
+{
+  QMutexLocker lock(&expressionCacheMutex);
+  return expressionCacheStatistics;
+}
+
 bool tryDirectLookup(const QByteArray& unit)
 {
   if (unit.isEmpty()) {
@@ -135,9 +184,61 @@ ExpressionEvaluationResult ExpressionParser::evaluateType( const QByteArray& uni
     return it.value();
   }
 
+  // mapping the AST and debug output are side effects the cache would skip
+  const bool useCache = !m_mapAst && !m_debug;
+  ExpressionCacheKey cacheKey;
+  TopContextRevisions::Snapshot imports;
+  if (useCache) {
+    DUChainReadLocker lock;
+    if (!context) {
+      return ExpressionEvaluationResult();
+    }
+    cacheKey.expression = unit;
+    cacheKey.context = context->indexed();
+    cacheKey.sourceTopContext = source ? source->ownIndex() : 0;
+    cacheKey.flags = (forceExpression ? 1 : 0) | (m_strict ? 2 : 0) | (m_propagateConstness ? 4 : 0);
+
+    QMutexLocker cacheLock(&expressionCacheMutex);
+    CachedExpression* cached = expressionCache.object(cacheKey);
+    if (cached && cached->imports.isCurrent()) {
+      ++expressionCacheStatistics.hits;
+      return cached->result;
+    }
+    ++expressionCacheStatistics.misses;
+
+    //The snapshot is taken before evaluating, so a rebuild during the evaluation makes the result outdated
+    ExpressionCacheKey contextKey(cacheKey);
+    contextKey.expression.clear();
+    contextKey.flags = 0;
+    TopContextRevisions::Snapshot* contextImports = expressionContextImports.object(contextKey);
+    if (!contextImports || !contextImports->isCurrent()) {
+      contextImports = new TopContextRevisions::Snapshot(TopContextRevisions::importClosure(context.data(), source));
+      expressionContextImports.insert(contextKey, contextImports);
+    }
+    imports = *contextImports;
+  }
+
+  ExpressionEvaluationResult ret = evaluateTypeUncached(unit, context, source, forceExpression);
+
+  if (useCache) {
+    CachedExpression* cached = new CachedExpression;
+    cached->imports = imports;
+    cached->result = ret;
+    QMutexLocker cacheLock(&expressionCacheMutex);
+    expressionCache.insert(cacheKey, cached);
+  }
+
+  return ret;
+}
+
+ExpressionEvaluationResult ExpressionParser::evaluateTypeUncached( const QByteArray& unit, DUContextPointer context, const TopDUContext* source, bool forceExpression ) {
+
   // fast path for direct lookup of identifiers
   if (!forceExpression && tryDirectLookup(unit)) {
     DUChainReadLocker lock;
+    if (!context) {
+      return ExpressionEvaluationResult();
+    }
     QList< Declaration* > decls = context->findDeclarations(QualifiedIdentifier(QString::fromUtf8(unit)),
                                                             CursorInRevision::invalid(),
                                                             AbstractType::Ptr(),
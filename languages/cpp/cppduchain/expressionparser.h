@@ -91,7 +91,23 @@ class KDEVCPPDUCHAIN_EXPORT ExpressionParser {
     */
     ExpressionEvaluationResult evaluateType( AST* ast, ParseSession* session, const KDevelop::TopDUContext* source = 0 );
 
+    struct CacheStatistics {
+      CacheStatistics() : hits(0), misses(0) {
+      }
+      uint hits;
+      uint misses;
+    };
+
+    /**
+     * Results of evaluating expression strings are cached per expression and context, until any top-context
+     * visible from the context is rebuilt, see TopContextRevisions.
+     * Returns how often the expression cache could be used since the application was started.
+     * */
+    static CacheStatistics cacheStatistics();
+
   private:
+    ExpressionEvaluationResult evaluateTypeUncached( const QByteArray& expression, DUContextPointer context, const KDevelop::TopDUContext* source, bool forceExpression );
+
     bool m_strict;
     bool m_debug;
     bool m_propagateConstness;
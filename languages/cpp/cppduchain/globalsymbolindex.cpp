@@ -0,0 +1,302 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "globalsymbolindex.h"
+
+#include <language/duchain/codemodel.h>
+#include <language/duchain/duchainlock.h>
+
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QtConcurrentRun>
+
+using namespace KDevelop;
+using namespace Cpp;
+
+namespace {
+
+///Compares the UTF-8 contents, ignoring the case of ASCII letters. Returns the length of the common prefix in @p common.
+int compareIgnoringCase(const char* lhs, int lhsLength, const char* rhs, int rhsLength, int* common = 0)
+{
+  const int length = qMin(lhsLength, rhsLength);
+  int a = 0;
+  for(; a < length; ++a) {
+    const char l = (lhs[a] >= 'A' && lhs[a] <= 'Z') ? lhs[a] - 'A' + 'a' : lhs[a];
+    const char r = (rhs[a] >= 'A' && rhs[a] <= 'Z') ? rhs[a] - 'A' + 'a' : rhs[a];
+    if(l != r) {
+      if(common)
+        *common = a;
+      return (uchar)l < (uchar)r ? -1 : 1;
+    }
+  }
+  if(common)
+    *common = a;
+  return lhsLength == rhsLength ? 0 : (lhsLength < rhsLength ? -1 : 1);
+}
+
+/**
+ * A name, ordered case-insensitively by its contents, so all names with a common prefix follow each other.
+ * Stored keys reference the string repository, keys only used for lookups hold their own contents, so searching
+ * does not add strings to the repository.
+ */
+class NameKey
+{
+  public:
+    explicit NameKey(const IndexedString& name) : m_name(name) {
+    }
+    explicit NameKey(const QString& lookup) : m_lookup(lookup.toUtf8()) {
+    }
+
+    bool operator<(const NameKey& rhs) const {
+      return compareIgnoringCase(data(), length(), rhs.data(), rhs.length()) < 0;
+    }
+
+    bool startsWith(const NameKey& prefix) const {
+      int common = 0;
+      compareIgnoringCase(data(), length(), prefix.data(), prefix.length(), &common);
+      return common == prefix.length();
+    }
+
+    const IndexedString& name() const {
+      return m_name;
+    }
+
+  private:
+    const char* data() const {
+      return m_lookup.isNull() ? m_name.c_str() : m_lookup.constData();
+    }
+    int length() const {
+      return m_lookup.isNull() ? m_name.length() : m_lookup.size();
+    }
+
+    IndexedString m_name;
+    QByteArray m_lookup;
+};
+
+///Symbols by their unqualified name, with the count of documents declaring each
+typedef QHash<IndexedQualifiedIdentifier, int> SymbolCounts;
+
+///Unqualified name -> symbols, names differing only in case share one entry
+QMap<NameKey, SymbolCounts> symbolsByName;
+///Initials of the camel-case humps -> names having them, with the count of symbols for each
+QMap<NameKey, QHash<IndexedString, int> > namesByInitials;
+QHash<IndexedString, QVector<IndexedQualifiedIdentifier> > symbolsByDocument;
+///All indexed documents, also those without any symbol
+QSet<IndexedString> indexedDocuments;
+QMutex globalSymbolIndexMutex;
+
+IndexedString unqualifiedName(const IndexedQualifiedIdentifier& id)
+{
+  const QualifiedIdentifier qid = id.identifier();
+  if(qid.isEmpty())
+    return IndexedString();
+  return qid.last().identifier();
+}
+
+QString initials(const QStringList& humps)
+{
+  QString ret;
+  foreach(const QString& hump, humps)
+    ret += hump.at(0).toLower();
+  return ret;
+}
+
+///globalSymbolIndexMutex must be locked
+void addSymbol(const IndexedQualifiedIdentifier& id)
+{
+  const IndexedString name = unqualifiedName(id);
+  if(name.isEmpty())
+    return;
+  ++symbolsByName[NameKey(name)][id];
+  ++namesByInitials[NameKey(IndexedString(initials(GlobalSymbolIndex::camelCaseHumps(name.str()))))][name];
+}
+
+///globalSymbolIndexMutex must be locked
+void removeSymbol(const IndexedQualifiedIdentifier& id)
+{
+  const IndexedString name = unqualifiedName(id);
+  if(name.isEmpty())
+    return;
+
+  QMap<NameKey, SymbolCounts>::iterator symbols = symbolsByName.find(NameKey(name));
+  if(symbols != symbolsByName.end()) {
+    SymbolCounts::iterator count = symbols->find(id);
+    if(count != symbols->end() && --(*count) <= 0)
+      symbols->erase(count);
+    if(symbols->isEmpty())
+      symbolsByName.erase(symbols);
+  }
+
+  QMap<NameKey, QHash<IndexedString, int> >::iterator names = namesByInitials.find(NameKey(initials(GlobalSymbolIndex::camelCaseHumps(name.str()))));
+  if(names != namesByInitials.end()) {
+    QHash<IndexedString, int>::iterator count = names->find(name);
+    if(count != names->end() && --(*count) <= 0)
+      names->erase(count);
+    if(names->isEmpty())
+      namesByInitials.erase(names);
+  }
+}
+
+///Whether each hump of the pattern is a case-insensitive prefix of the corresponding hump of the name
+bool humpsMatch(const QStringList& patternHumps, const QStringList& nameHumps)
+{
+  if(patternHumps.size() > nameHumps.size())
+    return false;
+  for(int a = 0; a < patternHumps.size(); ++a)
+    if(!nameHumps[a].startsWith(patternHumps[a], Qt::CaseInsensitive))
+      return false;
+  return true;
+}
+
+}
+
+void GlobalSymbolIndex::updateDocument(const IndexedString& document)
+{
+  QVector<IndexedQualifiedIdentifier> symbols;
+  {
+    DUChainReadLocker lock;
+    uint count;
+    const CodeModelItem* items;
+    CodeModel::self().items(document, count, items);
+    for(uint a = 0; a < count; ++a) {
+      //Members and namespaces never need an include of their own, and forward-declarations are not what is searched for
+      if(items[a].kind & (CodeModelItem::ClassMember | CodeModelItem::Namespace | CodeModelItem::ForwardDeclaration))
+        continue;
+      symbols << items[a].id;
+    }
+  }
+
+  QMutexLocker lock(&globalSymbolIndexMutex);
+  indexedDocuments.insert(document);
+  QHash<IndexedString, QVector<IndexedQualifiedIdentifier> >::iterator old = symbolsByDocument.find(document);
+  if(old != symbolsByDocument.end()) {
+    if(*old == symbols)
+      return;
+    foreach(const IndexedQualifiedIdentifier& id, *old)
+      removeSymbol(id);
+  }
+
+  foreach(const IndexedQualifiedIdentifier& id, symbols)
+    addSymbol(id);
+
+  if(symbols.isEmpty())
+    symbolsByDocument.remove(document);
+  else
+    symbolsByDocument.insert(document, symbols);
+}
+
+void GlobalSymbolIndex::ensureDocument(const IndexedString& document)
+{
+  {
+    QMutexLocker lock(&globalSymbolIndexMutex);
+    if(indexedDocuments.contains(document))
+      return;
+  }
+  updateDocument(document);
+}
+
+QFuture<void> GlobalSymbolIndex::ensureDocumentsInBackground(const QSet<IndexedString>& documents)
+{
+  return QtConcurrent::run([documents] () {
+    foreach(const IndexedString& document, documents)
+      ensureDocument(document);
+  });
+}
+
+QList<QualifiedIdentifier> GlobalSymbolIndex::findByPrefix(const QString& prefix, int maxCount)
+{
+  QList<QualifiedIdentifier> ret;
+  if(prefix.isEmpty())
+    return ret;
+  const NameKey prefixKey(prefix);
+
+  QMutexLocker lock(&globalSymbolIndexMutex);
+  for(QMap<NameKey, SymbolCounts>::const_iterator it = symbolsByName.lowerBound(prefixKey);
+      it != symbolsByName.constEnd() && it.key().startsWith(prefixKey); ++it)
+  {
+    for(SymbolCounts::const_iterator symbol = it->constBegin(); symbol != it->constEnd(); ++symbol) {
+      if(ret.size() >= maxCount)
+        return ret;
+      ret << symbol.key().identifier();
+    }
+  }
+  return ret;
+}
+
+QList<QualifiedIdentifier> GlobalSymbolIndex::findByCamelCase(const QString& pattern, int maxCount)
+{
+  QList<QualifiedIdentifier> ret;
+  //Every upper-case character starts a hump of the pattern, so "QSM" has three
+  QStringList patternHumps;
+  for(int a = 0; a < pattern.size(); ++a) {
+    if(pattern[a] == '_')
+      continue;
+    if(patternHumps.isEmpty() || pattern[a].isUpper() || pattern[a-1] == '_')
+      patternHumps << QString();
+    patternHumps.last() += pattern[a];
+  }
+  if(patternHumps.size() < 2)
+    return ret;
+  const NameKey patternInitials(initials(patternHumps));
+
+  QMutexLocker lock(&globalSymbolIndexMutex);
+  //Names differing only in case share their symbols, so each entry is visited only once
+  QSet<IndexedString> visitedNames;
+  for(QMap<NameKey, QHash<IndexedString, int> >::const_iterator it = namesByInitials.lowerBound(patternInitials);
+      it != namesByInitials.constEnd() && it.key().startsWith(patternInitials); ++it)
+  {
+    for(QHash<IndexedString, int>::const_iterator name = it->constBegin(); name != it->constEnd(); ++name) {
+      QMap<NameKey, SymbolCounts>::const_iterator symbols = symbolsByName.constFind(NameKey(name.key()));
+      if(symbols == symbolsByName.constEnd() || visitedNames.contains(symbols.key().name()))
+        continue;
+      visitedNames.insert(symbols.key().name());
+      for(SymbolCounts::const_iterator symbol = symbols->constBegin(); symbol != symbols->constEnd(); ++symbol) {
+        if(ret.size() >= maxCount)
+          return ret;
+        const QualifiedIdentifier id = symbol.key().identifier();
+        if(humpsMatch(patternHumps, camelCaseHumps(id.last().identifier().str())))
+          ret << id;
+      }
+    }
+  }
+  return ret;
+}
+
+QStringList GlobalSymbolIndex::camelCaseHumps(const QString& name)
+{
+  QStringList ret;
+  bool startHump = true;
+  for(int a = 0; a < name.size(); ++a) {
+    const QChar c = name[a];
+    if(c == '_') {
+      startHump = true;
+      continue;
+    }
+    if(a > 0 && c.isUpper()) {
+      const QChar previous = name[a-1];
+      //"QStateMachine" -> "Q", "State", "Machine", and "HTMLParser" -> "HTML", "Parser"
+      if(previous.isLower() || previous.isDigit() || (previous.isUpper() && a + 1 < name.size() && name[a+1].isLower()))
+        startHump = true;
+    }
+    if(startHump)
+      ret << QString();
+    startHump = false;
+    ret.last() += c;
+  }
+  return ret;
+}
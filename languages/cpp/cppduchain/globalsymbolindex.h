@@ -0,0 +1,71 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef GLOBALSYMBOLINDEX_H
+#define GLOBALSYMBOLINDEX_H
+
+#include <cppduchainexport.h>
+#include <language/duchain/identifier.h>
+#include <serialization/indexedstring.h>
+
+#include <QFuture>
+#include <QSet>
+#include <QStringList>
+
+namespace Cpp {
+
+/**
+ * Index over the names of all symbols declared at global or namespace scope, as found in the code-model.
+ *
+ * The persistent symbol table can only be asked for exact qualified identifiers. This index allows finding them
+ * from a partially typed name, either by a case-insensitive prefix of the unqualified name, or by the
+ * camel-case humps ("QSM" or "QStMa" for "QStateMachine").
+ *
+ * Documents are added when they are parsed, found up to date by the parse-job, or included from the DUChain without
+ * being parsed. The files of a project are added in the background when it is opened, see ensureDocumentsInBackground(),
+ * so the symbols of a warm DUChain are found before their files are touched again. Until that is done, the find
+ * functions return what is indexed so far.
+ * System headers are not added up front, they are only found once a file including them was parsed or updated.
+ *
+ * Names are matched case-insensitively for ASCII letters only.
+ * All functions are thread-safe.
+ */
+class KDEVCPPDUCHAIN_EXPORT GlobalSymbolIndex
+{
+  public:
+    ///Replaces the symbols indexed for @p document by the ones the code-model currently contains for it
+    static void updateDocument(const KDevelop::IndexedString& document);
+
+    ///Indexes @p document if it is not indexed yet. Cheap if it is.
+    static void ensureDocument(const KDevelop::IndexedString& document);
+
+    ///Indexes the given documents that are not indexed yet, from a background thread
+    static QFuture<void> ensureDocumentsInBackground(const QSet<KDevelop::IndexedString>& documents);
+
+    ///Returns the symbols whose unqualified name starts with @p prefix, ignoring case. At most @p maxCount are returned.
+    static QList<KDevelop::QualifiedIdentifier> findByPrefix(const QString& prefix, int maxCount);
+
+    ///Returns the symbols whose camel-case humps start with the humps of @p pattern. At most @p maxCount are returned.
+    static QList<KDevelop::QualifiedIdentifier> findByCamelCase(const QString& pattern, int maxCount);
+
+    ///Splits @p name into its camel-case humps, separated by case changes and underscores
+    static QStringList camelCaseHumps(const QString& name);
+};
+
+}
+
+#endif // GLOBALSYMBOLINDEX_H
@@ -0,0 +1,164 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "proxycontextstatistics.h"
+#include "debug.h"
+
+#include "parser/rpp/macrorepository.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QTextStream>
+
+#include <algorithm>
+
+using namespace KDevelop;
+using namespace Cpp;
+
+namespace {
+
+struct DocumentStatistics
+{
+  DocumentStatistics() : proxyContexts(0), reused(0), missed(0) {
+  }
+  int proxyContexts;
+  int reused;
+  int missed;
+  QHash<QString, int> missReasons;
+};
+
+///How many of the most frequent reasons are listed for each document
+const int maxReportedReasons = 3;
+
+QHash<IndexedString, DocumentStatistics> documentStatistics;
+QMutex documentStatisticsMutex;
+
+QString reportFile()
+{
+  return QString::fromLocal8Bit(qgetenv("KDEV_CPP_PROXY_STATISTICS"));
+}
+
+bool statisticsEnabled = !reportFile().isEmpty();
+
+}
+
+bool ProxyContextStatistics::isEnabled()
+{
+  return statisticsEnabled;
+}
+
+void ProxyContextStatistics::setEnabled(bool enabled)
+{
+  statisticsEnabled = enabled;
+}
+
+void ProxyContextStatistics::proxyContextCreated(const IndexedString& document)
+{
+  if(!statisticsEnabled)
+    return;
+  QMutexLocker lock(&documentStatisticsMutex);
+  ++documentStatistics[document].proxyContexts;
+}
+
+void ProxyContextStatistics::contentContextReused(const IndexedString& document)
+{
+  if(!statisticsEnabled)
+    return;
+  QMutexLocker lock(&documentStatisticsMutex);
+  ++documentStatistics[document].reused;
+}
+
+void ProxyContextStatistics::contentContextMissed(const IndexedString& document, const QString& reason)
+{
+  if(!statisticsEnabled)
+    return;
+  QMutexLocker lock(&documentStatisticsMutex);
+  DocumentStatistics& statistics(documentStatistics[document]);
+  ++statistics.missed;
+  ++statistics.missReasons[reason];
+}
+
+void ProxyContextStatistics::clear()
+{
+  QMutexLocker lock(&documentStatisticsMutex);
+  documentStatistics.clear();
+}
+
+QString ProxyContextStatistics::report(int maxDocuments)
+{
+  QList<QPair<IndexedString, DocumentStatistics> > documents;
+  {
+    QMutexLocker lock(&documentStatisticsMutex);
+    for(QHash<IndexedString, DocumentStatistics>::const_iterator it = documentStatistics.constBegin(); it != documentStatistics.constEnd(); ++it)
+      documents << qMakePair(it.key(), it.value());
+  }
+
+  std::sort(documents.begin(), documents.end(), [](const QPair<IndexedString, DocumentStatistics>& lhs, const QPair<IndexedString, DocumentStatistics>& rhs) {
+    return lhs.second.missed > rhs.second.missed;
+  });
+
+  QString ret;
+  QTextStream stream(&ret);
+  stream << "document\tproxy-contexts\treused\tmissed\treasons\n";
+  for(int a = 0; a < documents.size() && a < maxDocuments; ++a) {
+    const DocumentStatistics& statistics(documents[a].second);
+
+    QList<QPair<int, QString> > reasons;
+    for(QHash<QString, int>::const_iterator it = statistics.missReasons.constBegin(); it != statistics.missReasons.constEnd(); ++it)
+      reasons << qMakePair(it.value(), it.key());
+    std::sort(reasons.begin(), reasons.end(), [](const QPair<int, QString>& lhs, const QPair<int, QString>& rhs) {
+      return lhs.first > rhs.first;
+    });
+
+    QStringList reasonTexts;
+    for(int r = 0; r < reasons.size() && r < maxReportedReasons; ++r)
+      reasonTexts << QStringLiteral("%1 (%2x)").arg(reasons[r].second).arg(reasons[r].first);
+
+    stream << documents[a].first.str() << '\t' << statistics.proxyContexts << '\t' << statistics.reused << '\t'
+           << statistics.missed << '\t' << reasonTexts.join(QStringLiteral(", ")) << '\n';
+  }
+  stream.flush();
+  return ret;
+}
+
+void ProxyContextStatistics::writeReport()
+{
+  const QString fileName = reportFile();
+  if(fileName.isEmpty())
+    return;
+
+  QFile file(fileName);
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qCWarning(CPPDUCHAIN) << "could not write the proxy-context statistics to" << fileName;
+    return;
+  }
+  file.write(report().toUtf8());
+
+  //Macro bodies are shared between the macros of all proxy-contexts, so their sharing is reported alongside
+  const MacroBodyStatistics macroBodies = macroBodyStatistics();
+  QString bodies;
+  QTextStream stream(&bodies);
+  stream << "\nmacro bodies\treferences\tstored tokens\treferenced tokens\tdeduplication ratio\n"
+         << macroBodies.bodies << '\t' << macroBodies.references << '\t' << macroBodies.storedTokens << '\t'
+         << macroBodies.referencedTokens << '\t' << macroBodies.deduplicationRatio() << '\n';
+  stream.flush();
+  file.write(bodies.toUtf8());
+  qCDebug(CPPDUCHAIN) << "macro bodies:" << macroBodies.bodies << "stored tokens:" << macroBodies.storedTokens
+                      << "deduplication ratio:" << macroBodies.deduplicationRatio();
+}
@@ -0,0 +1,60 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef PROXYCONTEXTSTATISTICS_H
+#define PROXYCONTEXTSTATISTICS_H
+
+#include <cppduchainexport.h>
+#include <serialization/indexedstring.h>
+
+#include <QString>
+
+namespace Cpp {
+
+/**
+ * Counts, per header, how well the proxy-contexts of simplified matching (see environmentmanager.h) avoid re-parsing:
+ * How many proxy-contexts were created, how often an existing content-context could be re-used, and why it could not.
+ *
+ * The counting is disabled by default. It is enabled by setting the environment variable KDEV_CPP_PROXY_STATISTICS
+ * to the file the report is written to on shutdown, or with setEnabled().
+ */
+class KDEVCPPDUCHAIN_EXPORT ProxyContextStatistics
+{
+  public:
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static void proxyContextCreated(const KDevelop::IndexedString& document);
+    static void contentContextReused(const KDevelop::IndexedString& document);
+    ///@param reason Why no content-context could be re-used, for example the macro that differed
+    static void contentContextMissed(const KDevelop::IndexedString& document, const QString& reason);
+
+    static void clear();
+
+    /**
+     * Returns a tab-separated report of the documents with the most misses, with their counters and the most frequent reasons.
+     * @param maxDocuments How many documents are listed at most
+     */
+    static QString report(int maxDocuments = 100);
+
+    ///Writes the report, followed by the sharing statistics of the macro-body repository, into the file given by KDEV_CPP_PROXY_STATISTICS, if set
+    static void writeReport();
+};
+
+}
+
+#endif // PROXYCONTEXTSTATISTICS_H
@@ -32,6 +32,12 @@
 #include "sourcemanipulation.h"
 #include "ptrtomembertype.h"
 #include "overloadresolution.h"
+#include "adlhelper.h"
+#include "topcontextrevisions.h"
+#include "globalsymbolindex.h"
+#include "classmembercache.h"
+#include "visibledeclarationcache.h"
+#include "writelockstatistics.h"
 
 #include "rpp/chartools.h"
 #include "rpp/pp-engine.h"
@@ -408,6 +414,247 @@ void TestDUChain::testArrayType()
 
 }
 
+namespace {
+///Describes all uses in @p context and its children, with their ranges and the used declarations
+QStringList describeUses(DUContext* context)
+{
+  QStringList ret;
+  for (int a = 0; a < context->usesCount(); ++a) {
+    const Use& use(context->uses()[a]);
+    Declaration* declaration = use.usedDeclaration(context->topContext());
+    ret << QString("%1:%2-%3:%4 %5").arg(use.m_range.start.line).arg(use.m_range.start.column)
+                                     .arg(use.m_range.end.line).arg(use.m_range.end.column)
+                                     .arg(declaration ? declaration->qualifiedIdentifier().toString() : QString("<none>"));
+  }
+  foreach (DUContext* child, context->childContexts())
+    ret += describeUses(child);
+  return ret;
+}
+}
+
+void TestDUChain::testParallelUses()
+{
+  TEST_FILE_PARSE_ONLY
+
+  // Enough function definitions to trigger the parallel pre-evaluation, on different lines and columns,
+  // and with a macro so the location-table has anchors within the lines
+  QByteArray code("struct S { int m; };\nint g;\n#define ACCESS(s) s->m\n");
+  for (int a = 0; a < 40; ++a)
+    code += QString("void f%1(S* s) {\n%2int l = g;\n  ACCESS(s) = l + g; s->m = g;\n}\n").arg(a).arg(QString(a % 7, ' ')).toLatin1();
+
+  // Sequentially, and with two threads independent of the count of CPUs
+  QStringList sequentialUses;
+  for (int threads = 0; threads <= 2; threads += 2) {
+    LockedTopDUContext top = parse(code, DumpNone, 0, false, threads);
+    if (threads)
+      QVERIFY(m_replayedEvaluations > 0);
+    else
+      QCOMPARE(m_replayedEvaluations, 0);
+
+    QCOMPARE(top->localDeclarations().count(), 42);
+    Declaration* g = top->localDeclarations()[1];
+    QCOMPARE(g->uses().size(), 1);
+    QCOMPARE(g->uses().begin()->size(), 120);
+
+    DUContext* body = top->childContexts().last();
+    QCOMPARE(body->type(), DUContext::Other);
+    QCOMPARE(body->localDeclarations().count(), 1);
+
+    // Every use has the same range and declaration as when built sequentially
+    const QStringList uses = describeUses(top);
+    if (threads)
+      QCOMPARE(uses, sequentialUses);
+    else
+      sequentialUses = uses;
+  }
+}
+
+void TestDUChain::testWriteLockStatistics()
+{
+  TEST_FILE_PARSE_ONLY
+
+  // The write-lock sections of the builders are recorded into the histogram of the thread
+  Cpp::WriteLockHistogram histogram;
+  {
+    Cpp::WriteLockHistogram::Recording recording(&histogram);
+    LockedTopDUContext top = parse("namespace N { class A { int m; }; }\nusing namespace N;\nvoid f() { A a; }", DumpNone);
+    QCOMPARE(top->localDeclarations().count(), 3);
+  }
+  const uint sections = histogram.sections();
+  QVERIFY(sections > 0);
+
+  // Nothing is recorded without a histogram
+  parse("class B {};", DumpNone);
+  QCOMPARE(histogram.sections(), sections);
+}
+
+void TestDUChain::testPartialUses()
+{
+  TEST_FILE_PARSE_ONLY
+
+  QByteArray text("struct A { A f(); };\n"
+                  "int g;\n"
+                  "A A::f() {\n"
+                  "  A a;\n"
+                  "  g = 1;\n"
+                  "  return a;\n"
+                  "}\n");
+  LockedTopDUContext top = parse(text, DumpNone);
+  QCOMPARE(top->localDeclarations().count(), 3);
+  const int classUses = top->localDeclarations()[0]->uses().begin()->count();
+  //At least in the class, in the return-type or qualifier, and in the body
+  QVERIFY(classUses >= 3);
+  QCOMPARE(top->localDeclarations()[1]->uses().begin()->count(), 1);
+
+  //No function definition overlaps the first line, so the body of A::f is skipped
+  m_useLineRange = qMakePair(0, 0);
+  parse(text, DumpNone, top);
+  m_useLineRange = qMakePair(0, -1);
+
+  //The uses in the return-type and the qualifier belong to the surrounding context, and are built anyway
+  QCOMPARE(top->localDeclarations().count(), 3);
+  QCOMPARE(top->localDeclarations()[0]->uses().begin()->count(), classUses);
+  //The uses within the skipped body are left as they were
+  QCOMPARE(top->localDeclarations()[1]->uses().begin()->count(), 1);
+}
+
+void TestDUChain::testGlobalSymbolIndex()
+{
+  TEST_FILE_PARSE_ONLY
+
+  QCOMPARE(Cpp::GlobalSymbolIndex::camelCaseHumps("QStateMachine"), QStringList() << "Q" << "State" << "Machine");
+  QCOMPARE(Cpp::GlobalSymbolIndex::camelCaseHumps("HTMLParser"), QStringList() << "HTML" << "Parser");
+  QCOMPARE(Cpp::GlobalSymbolIndex::camelCaseHumps("m_lowerCase2"), QStringList() << "m" << "lower" << "Case2");
+
+  LockedTopDUContext top = parse("namespace Gsi { class GsiStateMachine {}; void gsiFunction(); } class GsiOther { void gsiMember(); };", DumpNone);
+  const IndexedString url = top->url();
+  const QualifiedIdentifier machine("Gsi::GsiStateMachine");
+  const QualifiedIdentifier function("Gsi::gsiFunction");
+
+  Cpp::GlobalSymbolIndex::updateDocument(url);
+
+  QList<QualifiedIdentifier> found = Cpp::GlobalSymbolIndex::findByPrefix("gsis", 10);
+  QCOMPARE(found, QList<QualifiedIdentifier>() << machine);
+  found = Cpp::GlobalSymbolIndex::findByPrefix("GSI", 10);
+  QVERIFY(found.contains(machine));
+  QVERIFY(found.contains(function));
+  QVERIFY(found.contains(QualifiedIdentifier("GsiOther")));
+  //Members are not indexed
+  QVERIFY(Cpp::GlobalSymbolIndex::findByPrefix("gsiMember", 10).isEmpty());
+
+  QVERIFY(Cpp::GlobalSymbolIndex::findByCamelCase("GSM", 10).contains(machine));
+  QCOMPARE(Cpp::GlobalSymbolIndex::findByCamelCase("GsStMa", 10), QList<QualifiedIdentifier>() << machine);
+  QVERIFY(Cpp::GlobalSymbolIndex::findByCamelCase("GsMa", 10).isEmpty());
+
+  //Documents that were not parsed in this session are added once, later changes need updateDocument()
+  LockedTopDUContext reused = parse("class GsiReused {};", DumpNone);
+  QVERIFY(Cpp::GlobalSymbolIndex::findByPrefix("gsiReused", 10).isEmpty());
+  Cpp::GlobalSymbolIndex::ensureDocument(reused->url());
+  QCOMPARE(Cpp::GlobalSymbolIndex::findByPrefix("gsiReused", 10), QList<QualifiedIdentifier>() << QualifiedIdentifier("GsiReused"));
+
+  //Names differing only in case are found once
+  LockedTopDUContext cased = parse("class GsiCaseMachine {}; class gsicasemachine {};", DumpNone);
+  Cpp::GlobalSymbolIndex::updateDocument(cased->url());
+  QCOMPARE(Cpp::GlobalSymbolIndex::findByPrefix("GSICASE", 10).size(), 2);
+  QCOMPARE(Cpp::GlobalSymbolIndex::findByCamelCase("GsCaMa", 10), QList<QualifiedIdentifier>() << QualifiedIdentifier("GsiCaseMachine"));
+
+  //Projects are added from a background thread, which needs the du-chain lock
+  LockedTopDUContext background = parse("class GsiBackground {};", DumpNone);
+  const IndexedString backgroundUrl = background->url();
+  QFuture<void> added = Cpp::GlobalSymbolIndex::ensureDocumentsInBackground(QSet<IndexedString>() << backgroundUrl);
+  DUChainWriteLocker* locks[] = {&top.m_writeLock, &reused.m_writeLock, &cased.m_writeLock, &background.m_writeLock};
+  for(DUChainWriteLocker* lock : locks)
+    lock->unlock();
+  added.waitForFinished();
+  for(DUChainWriteLocker* lock : locks)
+    lock->lock();
+  QCOMPARE(Cpp::GlobalSymbolIndex::findByPrefix("gsiBackground", 10), QList<QualifiedIdentifier>() << QualifiedIdentifier("GsiBackground"));
+}
+
+void TestDUChain::testClassMemberCache()
+{
+  TEST_FILE_PARSE_ONLY
+
+  LockedTopDUContext top = parse("class A { int a; void f(); }; class B : public A { int b; }; class C : public B { int c; };"
+                                 "template<class T> class D : public T { T d; }; D<A> da; D<C> dc;", DumpNone);
+  DUContext* classC = top->childContexts()[2];
+  QCOMPARE(classC->localScopeIdentifier(), QualifiedIdentifier("C"));
+
+  Cpp::ClassMemberCache::CacheStatistics before = Cpp::ClassMemberCache::cacheStatistics();
+  QList<QPair<Declaration*, int> > members = Cpp::ClassMemberCache::allMembers(classC, top);
+  QCOMPARE(members, classC->allDeclarations(CursorInRevision::invalid(), top, false));
+  QCOMPARE(members.size(), 4);
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().misses, before.misses + 1);
+
+  //The second request is served from the cache
+  QCOMPARE(Cpp::ClassMemberCache::allMembers(classC, top), members);
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().hits, before.hits + 1);
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().misses, before.misses + 1);
+
+  //Rebuilding the top-context the hierarchy is declared in drops the members
+  Cpp::TopContextRevisions::bump(top->indexed());
+  QCOMPARE(Cpp::ClassMemberCache::allMembers(classC, top), members);
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().hits, before.hits + 1);
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().misses, before.misses + 2);
+
+  //Each instantiation of a template is cached separately
+  QList<DUContext*> instantiations;
+  foreach(const char* variable, QList<const char*>() << "da" << "dc") {
+    QList<Declaration*> decls = top->findDeclarations(Identifier(variable));
+    QCOMPARE(decls.size(), 1);
+    StructureType::Ptr type = decls[0]->abstractType().cast<StructureType>();
+    QVERIFY(type);
+    QVERIFY(type->declaration(top));
+    QVERIFY(type->declaration(top)->internalContext());
+    instantiations << type->declaration(top)->internalContext();
+  }
+  QVERIFY(instantiations[0] != instantiations[1]);
+  before = Cpp::ClassMemberCache::cacheStatistics();
+  foreach(DUContext* instantiation, instantiations)
+    QCOMPARE(Cpp::ClassMemberCache::allMembers(instantiation, top), instantiation->allDeclarations(CursorInRevision::invalid(), top, false));
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().misses, before.misses + 2);
+  foreach(DUContext* instantiation, instantiations)
+    QCOMPARE(Cpp::ClassMemberCache::allMembers(instantiation, top), instantiation->allDeclarations(CursorInRevision::invalid(), top, false));
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().hits, before.hits + 2);
+
+  //Non-class contexts are not cached, but still answered
+  before = Cpp::ClassMemberCache::cacheStatistics();
+  QCOMPARE(Cpp::ClassMemberCache::allMembers(top, top), top->allDeclarations(CursorInRevision::invalid(), top, false));
+  QCOMPARE(Cpp::ClassMemberCache::cacheStatistics().misses, before.misses);
+}
+
+void TestDUChain::testVisibleDeclarationCache()
+{
+  TEST_FILE_PARSE_ONLY
+
+  LockedTopDUContext top = parse("int a; void f() { int b;                int c; }", DumpNone);
+  DUContext* body = top->childContexts().last();
+  QCOMPARE(body->localDeclarations().count(), 2);
+
+  const CursorInRevision first(0, 30), second(0, 35), behind(0, 48);
+  const Cpp::VisibleDeclarationCache::CacheStatistics before = Cpp::VisibleDeclarationCache::cacheStatistics();
+  QList<QPair<Declaration*, int> > visible = Cpp::VisibleDeclarationCache::allDeclarations(body, first, top);
+  QCOMPARE(visible, body->allDeclarations(first, top));
+  QCOMPARE(Cpp::VisibleDeclarationCache::cacheStatistics().misses, before.misses + 1);
+
+  //No declaration lies between the positions, so the list is shared
+  QCOMPARE(Cpp::VisibleDeclarationCache::allDeclarations(body, second, top), visible);
+  QCOMPARE(Cpp::VisibleDeclarationCache::cacheStatistics().hits, before.hits + 1);
+
+  //A declaration lies in between, so a separate list is computed and kept
+  QCOMPARE(Cpp::VisibleDeclarationCache::allDeclarations(body, behind, top), body->allDeclarations(behind, top));
+  QCOMPARE(Cpp::VisibleDeclarationCache::cacheStatistics().misses, before.misses + 2);
+  QCOMPARE(Cpp::VisibleDeclarationCache::allDeclarations(body, behind, top).size(), visible.size() + 1);
+  QCOMPARE(Cpp::VisibleDeclarationCache::allDeclarations(body, first, top), visible);
+  QCOMPARE(Cpp::VisibleDeclarationCache::cacheStatistics().hits, before.hits + 3);
+
+  //Rebuilding a visible top-context drops the lists
+  Cpp::TopContextRevisions::bump(top->indexed());
+  QCOMPARE(Cpp::VisibleDeclarationCache::allDeclarations(body, first, top), visible);
+  QCOMPARE(Cpp::VisibleDeclarationCache::cacheStatistics().misses, before.misses + 3);
+  QCOMPARE(Cpp::VisibleDeclarationCache::cacheStatistics().hits, before.hits + 3);
+}
+
 void TestDUChain::testProblematicUses()
 {
   TEST_FILE_PARSE_ONLY
@@ -2336,6 +2583,36 @@ void TestDUChain::testADLEllipsis()
   QCOMPARE(top->localDeclarations().at(2)->uses().begin().value().size(), 1);
 }
 
+void TestDUChain::testADLCache()
+{
+  TEST_FILE_PARSE_ONLY
+
+  LockedTopDUContext header = parse("namespace B { struct Base {}; } namespace C { struct Base {}; } namespace A { struct S : B::Base {}; }", DumpNone);
+  LockedTopDUContext user = parse("int i;", DumpNone);
+  user->addImportedParentContext(header);
+
+  QList<Declaration*> decls = header->findDeclarations(QualifiedIdentifier("A::S"));
+  QCOMPARE(decls.size(), 1);
+  {
+    ADLHelper helper(DUContextPointer(user), TopDUContextPointer(user));
+    helper.addArgument(OverloadResolver::Parameter(decls.first()->abstractType(), false));
+    QVERIFY(helper.associatedNamespaces().contains(QualifiedIdentifier("B")));
+  }
+
+  //Rebuilding the imported header drops the namespaces memoized for its importer, as done by the parse-job
+  parse("namespace B { struct Base {}; } namespace C { struct Base {}; } namespace A { struct S : C::Base {}; }", DumpNone, header);
+  Cpp::TopContextRevisions::bump(header->indexed());
+
+  decls = header->findDeclarations(QualifiedIdentifier("A::S"));
+  QCOMPARE(decls.size(), 1);
+  {
+    ADLHelper helper(DUContextPointer(user), TopDUContextPointer(user));
+    helper.addArgument(OverloadResolver::Parameter(decls.first()->abstractType(), false));
+    QVERIFY(helper.associatedNamespaces().contains(QualifiedIdentifier("C")));
+    QVERIFY(!helper.associatedNamespaces().contains(QualifiedIdentifier("B")));
+  }
+}
+
 
 void TestDUChain::testAssignmentOperators()
 {
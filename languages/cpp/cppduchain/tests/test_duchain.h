@@ -96,6 +96,7 @@ private slots:
   void testADLTemplateArguments();
   void testADLTemplateTemplateArguments();
   void testADLEllipsis();
+  void testADLCache();
   void testAssignmentOperators();
   void testTemplateEnums();
   void testIntegralTemplates();
@@ -166,6 +167,12 @@ private slots:
   
   void testBaseUses();
   void testProblematicUses();
+  void testParallelUses();
+  void testWriteLockStatistics();
+  void testPartialUses();
+  void testGlobalSymbolIndex();
+  void testClassMemberCache();
+  void testVisibleDeclarationCache();
 
   void testCStruct();
   void testCStruct2();
@@ -28,8 +28,18 @@
 #include <tests/testcore.h>
 #include <tests/autotestshell.h>
 
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/editor/modificationrevision.h>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryFile>
 #include <QTest>
 
+#include <utime.h>
+
 QTEST_GUILESS_MAIN(TestEnvironment);
 
 using namespace KDevelop;
@@ -88,3 +98,117 @@ void TestEnvironment::benchMerge_data()
   QTest::newRow("5000") << 5000;
 }
 
+void TestEnvironment::testMacroBodySharing()
+{
+  MacroDataRepository& repository = EnvironmentManager::self()->macroDataRepository();
+
+  rpp::pp_macro first(IndexedString("sharedBodyMacro"));
+  first.setDefinitionText("1 + 2 * sharedBodyValue");
+  first.file = IndexedString("/a.h");
+  first.sourceLine = 1;
+  rpp::pp_macro second(first);
+  second.file = IndexedString("/b.h");
+  second.invalidateHash();
+
+  const MacroBodyStatistics before = macroBodyStatistics();
+  const uint firstIndex = repository.index(MacroRepositoryItemRequest(first));
+  const uint secondIndex = repository.index(MacroRepositoryItemRequest(second));
+  QVERIFY(firstIndex != secondIndex);
+
+  //Both versions of the macro share one body
+  const rpp::pp_macro* firstItem = repository.itemFromIndex(firstIndex);
+  const rpp::pp_macro* secondItem = repository.itemFromIndex(secondIndex);
+  QVERIFY(firstItem->m_definitionBody);
+  QCOMPARE(firstItem->m_definitionBody, secondItem->m_definitionBody);
+  QVERIFY(*firstItem == first);
+  QCOMPARE(rpp::pp_macro(*secondItem).toString(), second.toString());
+
+  const MacroBodyStatistics after = macroBodyStatistics();
+  QCOMPARE(after.bodies, before.bodies + 1);
+  QCOMPARE(after.references, before.references + 2);
+  QVERIFY(after.referencedTokens > after.storedTokens);
+
+  //The body is removed with the last macro using it
+  repository.deleteItem(secondIndex);
+  QCOMPARE(macroBodyStatistics().bodies, after.bodies);
+  repository.deleteItem(firstIndex);
+  QCOMPARE(macroBodyStatistics().bodies, before.bodies);
+}
+
+namespace {
+bool setModificationTime(const QString& fileName, time_t time)
+{
+  struct utimbuf times;
+  times.actime = time;
+  times.modtime = time;
+  return utime(QFile::encodeName(fileName).constData(), &times) == 0;
+}
+}
+
+void TestEnvironment::testTouchedFileContents()
+{
+  QTemporaryFile temporary(QDir::tempPath() + "/testtouched_XXXXXX.h");
+  QVERIFY(temporary.open());
+  const QByteArray contents("int touched;\n");
+  temporary.write(contents);
+  temporary.close();
+  const IndexedString url(temporary.fileName());
+
+  ParsingEnvironmentFilePointer fileP(new EnvironmentFile(url, 0));
+  EnvironmentFile* file = static_cast<EnvironmentFile*>(fileP.data());
+  {
+    DUChainWriteLocker lock;
+    file->setModificationRevision(ModificationRevision::revisionForFile(url));
+    file->setContentHash(EnvironmentFile::hashContents(contents));
+    QVERIFY(!file->needsUpdate());
+  }
+
+  //Touch the file without changing its contents, like switching branches does.
+  //The modification-times are set explicitly, as they only have a resolution of seconds.
+  const time_t written = QFileInfo(temporary.fileName()).lastModified().toTime_t();
+  QVERIFY(temporary.open());
+  temporary.resize(0);
+  temporary.write(contents);
+  temporary.close();
+  QVERIFY(setModificationTime(temporary.fileName(), written + 10));
+  ModificationRevision::clearModificationCache(url);
+  const ModificationRevision touched = ModificationRevision::revisionForFile(url);
+  QVERIFY(touched != file->modificationRevision());
+
+  {
+    //The contents are not read with the DUChain locked, so the touched file counts as changed until it is hashed
+    DUChainReadLocker lock;
+    QList<IndexedString> unhashedFiles;
+    QVERIFY(file->needsUpdate(0, &unhashedFiles));
+    QCOMPARE(unhashedFiles, QList<IndexedString>() << url);
+  }
+
+  EnvironmentFile::hashFilesOnDisk(QList<IndexedString>() << url);
+  {
+    DUChainReadLocker lock;
+    QList<IndexedString> unhashedFiles;
+    QVERIFY(!file->needsUpdate(0, &unhashedFiles));
+    QVERIFY(unhashedFiles.isEmpty());
+  }
+
+  //The new modification-revision is stored, so the contents are not compared again
+  EnvironmentFile::refreshTouchedRevisions();
+  {
+    DUChainReadLocker lock;
+    QCOMPARE(file->modificationRevision(), touched);
+    QVERIFY(!file->needsUpdate());
+  }
+
+  //Real changes are still noticed
+  QVERIFY(temporary.open());
+  temporary.resize(0);
+  temporary.write("int changed;\n");
+  temporary.close();
+  QVERIFY(setModificationTime(temporary.fileName(), written + 20));
+  ModificationRevision::clearModificationCache(url);
+  EnvironmentFile::hashFilesOnDisk(QList<IndexedString>() << url);
+  {
+    DUChainReadLocker lock;
+    QVERIFY(file->needsUpdate());
+  }
+}
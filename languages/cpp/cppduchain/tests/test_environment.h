@@ -35,6 +35,9 @@ private slots:
 
   void benchMerge();
   void benchMerge_data();
+
+  void testMacroBodySharing();
+  void testTouchedFileContents();
 };
 
 #endif // TEST_ENVIRONMENT_H
@@ -40,6 +40,7 @@
 #include "rpp/preprocessor.h"
 #include "expressionvisitor.h"
 #include "expressionparser.h"
+#include "topcontextrevisions.h"
 #include "typeconversion.h"
 
 #include <tests/autotestshell.h>
@@ -1330,6 +1331,63 @@ void TestExpressionParser::testReference()
 
 }
 
+void TestExpressionParser::testExpressionCache()
+{
+  QByteArray method("struct Cont { int a; }; Cont c;");
+
+  TopDUContext* top = parse(method, DumpNone);
+  KDevelop::DUContextPointer testContext(top);
+  DUChainWriteLocker lock;
+  Cpp::ExpressionParser parser;
+  Cpp::ExpressionEvaluationResult result;
+
+  const Cpp::ExpressionParser::CacheStatistics before = Cpp::ExpressionParser::cacheStatistics();
+  result = parser.evaluateType( "c.a", testContext);
+  QVERIFY(result.isValid());
+  QCOMPARE(result.type.abstractType()->toString(), QString("int"));
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().misses, before.misses + 1);
+
+  result = parser.evaluateType( "c.a", testContext);
+  QVERIFY(result.isValid());
+  QCOMPARE(result.type.abstractType()->toString(), QString("int"));
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().hits, before.hits + 1);
+
+  //Evaluating as expression is cached separately
+  result = parser.evaluateExpression( "c.a", testContext);
+  QVERIFY(result.isValid());
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().misses, before.misses + 2);
+
+  Cpp::TopContextRevisions::bump(top->indexed());
+  result = parser.evaluateType( "c.a", testContext);
+  QVERIFY(result.isValid());
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().hits, before.hits + 1);
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().misses, before.misses + 3);
+
+  //Results evaluated in an importing context are dropped when the imported top-context is rebuilt
+  lock.unlock();
+  TopDUContext* importer = parse("int x;", DumpNone);
+  lock.lock();
+  importer->addImportedParentContext(top);
+  KDevelop::DUContextPointer importerContext(importer);
+
+  result = parser.evaluateType( "c.a", importerContext);
+  QVERIFY(result.isValid());
+  QCOMPARE(result.type.abstractType()->toString(), QString("int"));
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().misses, before.misses + 4);
+
+  result = parser.evaluateType( "c.a", importerContext);
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().hits, before.hits + 2);
+
+  Cpp::TopContextRevisions::bump(top->indexed());
+  result = parser.evaluateType( "c.a", importerContext);
+  QVERIFY(result.isValid());
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().hits, before.hits + 2);
+  QCOMPARE(Cpp::ExpressionParser::cacheStatistics().misses, before.misses + 5);
+
+  release(importer);
+  release(top);
+}
+
 
 void TestExpressionParser::testCharacterTypes_data()
 {
@@ -75,6 +75,7 @@ private slots:
   void testConstnessOverload();
   void testConstnessOverloadSubscript();
   void testReference();
+  void testExpressionCache();
 
   void testCharacterTypes_data();
   void testCharacterTypes();
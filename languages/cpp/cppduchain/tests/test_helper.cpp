@@ -92,7 +92,7 @@ void TestHelper::initShell()
   KDevelop::CodeRepresentation::setDiskChangesForbidden(true);
 }
 
-TopDUContext* TestHelper::parse(const QByteArray& unit, DumpAreas dump, TopDUContext* update, bool keepAst)
+TopDUContext* TestHelper::parse(const QByteArray& unit, DumpAreas dump, TopDUContext* update, bool keepAst, int parallelUseThreads)
 {
   m_modifications.clear();
   m_ctlflowGraph.clear();
@@ -143,7 +143,10 @@ TopDUContext* TestHelper::parse(const QByteArray& unit, DumpAreas dump, TopDUCon
 
   UseBuilder useBuilder(session.data());
   useBuilder.setMapAst(keepAst);
+  useBuilder.setParallelFunctionBodies(parallelUseThreads > 0, parallelUseThreads);
+  useBuilder.setLineRange(m_useLineRange.first, m_useLineRange.second);
   useBuilder.buildUses(ast);
+  m_replayedEvaluations = useBuilder.replayedEvaluations();
 
   UseDecoratorVisitor visit(session.data(), &m_modifications);
   visit.run(ast);
@@ -53,6 +53,8 @@ struct LockedTopDUContext
 
 class TestHelper {
 public:
+  TestHelper() : m_replayedEvaluations(0), m_useLineRange(0, -1) {
+  }
 
   enum DumpArea {
     DumpNone = 0,
@@ -67,10 +69,15 @@ public:
 
   KDevelop::TopDUContext* parse(const QByteArray& unit,
                                 DumpAreas dump = DumpAreas(DumpType),
-                                KDevelop::TopDUContext* update = 0, bool keepAst = false);
+                                KDevelop::TopDUContext* update = 0, bool keepAst = false,
+                                int parallelUseThreads = 0);
 protected:
   KDevelop::DataAccessRepository m_modifications;
   KDevelop::ControlFlowGraph m_ctlflowGraph;
+  ///The count of expressions the last parse() evaluated in parallel, see UseBuilder::replayedEvaluations()
+  int m_replayedEvaluations;
+  ///If not empty, parse() only builds the uses of the function bodies within these lines, see UseBuilder::setLineRange()
+  QPair<int, int> m_useLineRange;
 
 private:
   // Parser
@@ -0,0 +1,106 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "topcontextrevisions.h"
+
+#include <language/duchain/topducontext.h>
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+
+using namespace KDevelop;
+using namespace Cpp;
+
+namespace {
+
+QHash<uint, uint> topContextRevisions;
+///Increased with every rebuilt top-context, so snapshots only need to be compared when it changed
+uint topContextGeneration = 1;
+QMutex topContextRevisionsMutex;
+
+///Collects the top-contexts of @p context, optionally its parents, and all contexts they import. The DUChain must be read-locked.
+void collectTopContexts(const DUContext* context, const TopDUContext* source, bool searchInParents, QSet<const DUContext*>& visited, QSet<uint>& topContexts)
+{
+  for(; context && !visited.contains(context); context = searchInParents ? context->parentContext() : 0) {
+    visited.insert(context);
+    topContexts.insert(context->topContext()->ownIndex());
+    foreach(const DUContext::Import& import, context->importedParentContexts()) {
+      DUContext* imported = import.context(source);
+      if(imported)
+        collectTopContexts(imported, source, searchInParents, visited, topContexts);
+    }
+  }
+}
+
+}
+
+TopContextRevisions::Snapshot::Snapshot()
+  : m_checkedGeneration(0)
+{
+}
+
+bool TopContextRevisions::Snapshot::isCurrent() const
+{
+  QMutexLocker lock(&topContextRevisionsMutex);
+  if(m_checkedGeneration == topContextGeneration)
+    return true;
+
+  for(QVector<QPair<uint, uint> >::const_iterator it = m_revisions.constBegin(); it != m_revisions.constEnd(); ++it)
+    if(topContextRevisions.value(it->first) != it->second)
+      return false;
+
+  m_checkedGeneration = topContextGeneration;
+  return true;
+}
+
+int TopContextRevisions::Snapshot::size() const
+{
+  return m_revisions.size();
+}
+
+TopContextRevisions::Snapshot TopContextRevisions::takeSnapshot(const DUContext* context, const TopDUContext* source, bool searchInParents)
+{
+  QSet<const DUContext*> visited;
+  QSet<uint> topContexts;
+  collectTopContexts(context, source, searchInParents, visited, topContexts);
+
+  Snapshot ret;
+  ret.m_revisions.reserve(topContexts.size());
+  QMutexLocker lock(&topContextRevisionsMutex);
+  foreach(uint topContext, topContexts)
+    ret.m_revisions << qMakePair(topContext, topContextRevisions.value(topContext));
+  ret.m_checkedGeneration = topContextGeneration;
+  return ret;
+}
+
+TopContextRevisions::Snapshot TopContextRevisions::importClosure(const DUContext* context, const TopDUContext* source)
+{
+  return takeSnapshot(context, source, true);
+}
+
+TopContextRevisions::Snapshot TopContextRevisions::importsOf(const DUContext* context, const TopDUContext* source)
+{
+  return takeSnapshot(context, source, false);
+}
+
+void TopContextRevisions::bump(const IndexedTopDUContext& topContext)
+{
+  QMutexLocker lock(&topContextRevisionsMutex);
+  ++topContextRevisions[topContext.index()];
+  ++topContextGeneration;
+}
@@ -0,0 +1,85 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef TOPCONTEXTREVISIONS_H
+#define TOPCONTEXTREVISIONS_H
+
+#include <cppduchainexport.h>
+#include <language/duchain/ducontext.h>
+#include <language/duchain/indexedtopducontext.h>
+
+#include <QPair>
+#include <QVector>
+
+namespace Cpp {
+
+/**
+ * Counts how often each top-context was rebuilt, so caches can tell whether results they computed from a set of
+ * top-contexts are still valid.
+ *
+ * A cache takes a snapshot of the top-contexts a result depends on when it computes the result, and re-uses the
+ * result as long as the snapshot is current. Usually the snapshot covers the import-closure of a context, so
+ * results depending on declarations from included headers are dropped when one of the headers is rebuilt.
+ */
+class KDEVCPPDUCHAIN_EXPORT TopContextRevisions
+{
+  public:
+    ///The revisions of a set of top-contexts at the time the snapshot was taken
+    class KDEVCPPDUCHAIN_EXPORT Snapshot
+    {
+      public:
+        Snapshot();
+
+        /**
+         * Whether none of the top-contexts were rebuilt since the snapshot was taken.
+         * The revisions are only compared again after any top-context was rebuilt, else this is very cheap.
+         * Not thread-safe for the same snapshot, a cache must only call it with its own mutex locked.
+         */
+        bool isCurrent() const;
+
+        ///The count of top-contexts the snapshot covers
+        int size() const;
+
+      private:
+        friend class TopContextRevisions;
+        QVector<QPair<uint, uint> > m_revisions;
+        mutable uint m_checkedGeneration;
+    };
+
+    /**
+     * Takes a snapshot of the top-contexts of @p context, its parent-contexts, and all contexts they import recursively.
+     * @warning The DUChain must be read-locked
+     */
+    static Snapshot importClosure(const KDevelop::DUContext* context, const KDevelop::TopDUContext* source);
+
+    /**
+     * Takes a snapshot of the top-contexts of @p context and all contexts it imports recursively, without the parent-contexts.
+     * This is enough for results computed from a class and its base-classes.
+     * @warning The DUChain must be read-locked
+     */
+    static Snapshot importsOf(const KDevelop::DUContext* context, const KDevelop::TopDUContext* source);
+
+    ///Marks the top-context as rebuilt. Must be called by the parse job whenever it rebuilds a top-context.
+    static void bump(const KDevelop::IndexedTopDUContext& topContext);
+
+  private:
+    static Snapshot takeSnapshot(const KDevelop::DUContext* context, const KDevelop::TopDUContext* source, bool searchInParents);
+};
+
+}
+
+#endif // TOPCONTEXTREVISIONS_H
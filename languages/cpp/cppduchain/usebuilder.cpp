@@ -29,13 +29,27 @@
 #include "typeconversion.h"
 #include "debug.h"
 #include <parsesession.h>
+#include <util/pushvalue.h>
 
 #include <KLocalizedString>
 
+#include <QMutex>
+#include <QThread>
+#include <QRunnable>
+#include <QThreadPool>
+
 using namespace KDevelop;
 
+///Below this count of function definitions, the parallel pre-evaluation is not worth the overhead
+const int minimumParallelFunctionDefinitions = 16;
+
 UseBuilder::UseBuilder (ParseSession* session)
   : UseBuilderBase(session)
+  , m_parallelFunctionBodies(false)
+  , m_parallelThreadCount(0)
+  , m_replayedEvaluations(0)
+  , m_firstLine(0)
+  , m_lastLine(-1)
 {
 }
 
@@ -50,10 +64,46 @@ void UseBuilder::buildUses(AST *node)
     DUChainReadLocker lock(DUChain::lock());
     topContext = TopDUContextPointer(node->ducontext->topContext());
   }
+  m_replayedEvaluations = 0;
+  //Must happen before the conversion cache is enabled, the helper threads manage their own caches
+  if(m_parallelFunctionBodies && !m_mapAst)
+    prefetchFunctionBodies(node);
+
   //We will have some caching in TopDUContext until this objects lifetime is over
   Cpp::TypeConversionCacheEnabler enableConversionCache;
 
   UseBuilderBase::buildUses(node);
+
+  m_prefetched.clear();
+}
+
+void UseBuilder::setParallelFunctionBodies(bool parallel, int threadCount)
+{
+  m_parallelFunctionBodies = parallel;
+  m_parallelThreadCount = threadCount;
+}
+
+int UseBuilder::replayedEvaluations() const
+{
+  return m_replayedEvaluations;
+}
+
+void UseBuilder::setLineRange(int firstLine, int lastLine)
+{
+  m_firstLine = firstLine;
+  m_lastLine = lastLine;
+}
+
+void UseBuilder::visitFunctionDefinition(FunctionDefinitionAST* node)
+{
+  bool skipBody = false;
+  if(m_lastLine >= m_firstLine) {
+    const RangeInRevision range = editor()->findRange(node);
+    skipBody = range.end.line < m_firstLine || range.start.line > m_lastLine;
+  }
+  //The body contexts are then not opened at all, so their uses stay as they are
+  PushValue<bool> skip(m_onlyComputeVisible, m_onlyComputeVisible || skipBody);
+  UseBuilderBase::visitFunctionDefinition(node);
 }
 
 void UseBuilder::visitExpressionOrDeclarationStatement(ExpressionOrDeclarationStatementAST * exp) {
@@ -130,22 +180,37 @@ void UseBuilder::visitQPropertyDeclaration(QPropertyDeclarationAST* node)
 
 class UseExpressionVisitor : public Cpp::ExpressionVisitor {
   public:
-  UseExpressionVisitor(ParseSession* session, UseBuilder* useBuilder, bool dumpProblems = false, bool mapAst = false)
-    : Cpp::ExpressionVisitor(session, 0, false, false, mapAst), m_builder(useBuilder), m_dumpProblems(dumpProblems) {
+  ///@param record If this is nonzero, the uses and problems are recorded into it instead of being given to the builder
+  UseExpressionVisitor(ParseSession* session, UseBuilder* useBuilder, bool dumpProblems = false, bool mapAst = false, UseBuilder::PrefetchedEvaluation* record = 0)
+    : Cpp::ExpressionVisitor(session, 0, false, false, mapAst), m_builder(useBuilder), m_dumpProblems(dumpProblems), m_record(record) {
     reportRealProblems(true);
   }
   ~UseExpressionVisitor() {
     typedef QExplicitlySharedDataPointer<KDevelop::Problem> P;
-    foreach(const P& problem, realProblems())
-      m_builder->addProblem(problem);
+    foreach(const P& problem, realProblems()) {
+      if(m_record)
+        m_record->problems << problem;
+      else
+        m_builder->addProblem(problem);
+    }
   }
   private:
 
     virtual void usingDeclaration(AST* node,
                                   size_t start_token, size_t end_token,
                                   const KDevelop::DeclarationPointer& decl) override {
-      RangeInRevision range = m_builder->editor()->findRange(start_token, end_token);
-      m_builder->newUse(node, range, decl);
+      if(m_record) {
+        //The builder's editor must not be shared with other threads
+        CppEditorIntegrator editor(session());
+        UseBuilder::PrefetchedUse use;
+        use.node = node;
+        use.range = editor.findRange(start_token, end_token);
+        use.declaration = decl;
+        m_record->uses << use;
+      }else{
+        RangeInRevision range = m_builder->editor()->findRange(start_token, end_token);
+        m_builder->newUse(node, range, decl);
+      }
 
       if (decl && decl->isExplicitlyDeleted()) {
         QExplicitlySharedDataPointer<KDevelop::Problem> problem(new Problem);
@@ -171,14 +236,235 @@ class UseExpressionVisitor : public Cpp::ExpressionVisitor {
 
     UseBuilder* m_builder;
     bool m_dumpProblems;
+    UseBuilder::PrefetchedEvaluation* m_record;
+};
+
+namespace {
+///Remembers the contexts assigned to all AST nodes below a node, so they can be restored after evaluating expressions
+class DUContextBackup : public DefaultVisitor {
+  public:
+    explicit DUContextBackup(AST* node) {
+      visit(node);
+    }
+
+    void restore() const {
+      for(QVector<QPair<AST*, DUContext*> >::const_iterator it = m_contexts.constBegin(); it != m_contexts.constEnd(); ++it)
+        it->first->ducontext = it->second;
+    }
+
+    virtual void visit(AST* node) override {
+      if(!node)
+        return;
+      m_contexts << qMakePair(node, node->ducontext);
+      DefaultVisitor::visit(node);
+    }
+
+  private:
+    QVector<QPair<AST*, DUContext*> > m_contexts;
+};
+
+///Collects all function definitions that have a body, without descending into them
+class FunctionDefinitionCollector : public DefaultVisitor {
+  public:
+    QVector<FunctionDefinitionAST*> functions;
+
+  protected:
+    virtual void visitFunctionDefinition(FunctionDefinitionAST* node) override {
+      if(node->function_body)
+        functions << node;
+    }
+};
+
+/**
+ * Evaluates the expressions within one function definition, at the same places where UseBuilder evaluates them.
+ * The context is taken from the closest AST node that was assigned one by the declaration builder.
+ * Places where the sequential pass ends up in a different context are simply evaluated again by it.
+ */
+class ExpressionPrefetcher : public DefaultVisitor {
+  public:
+    ExpressionPrefetcher(ParseSession* session, UseBuilder* builder, UseBuilder::PrefetchedEvaluations* results)
+      : m_session(session), m_builder(builder), m_results(results), m_context(0) {
+    }
+
+    /**
+     * The expression- and type-visitors assign contexts to the nodes they evaluate, and the sequential pass
+     * decides by those whether it still has to assign one. Those writes stay within the function definition,
+     * which no other thread evaluates, and are reverted before returning.
+     */
+    void run(FunctionDefinitionAST* node) {
+      const DUContextBackup initializers(node->constructor_initializers), body(node->function_body);
+      visit(node->constructor_initializers);
+      visit(node->function_body);
+      initializers.restore();
+      body.restore();
+    }
+
+    virtual void visit(AST* node) override {
+      if(!node)
+        return;
+      PushPositiveValue<DUContext*> pushContext(m_context, node->ducontext);
+      DefaultVisitor::visit(node);
+    }
+
+  protected:
+    virtual void visitExpressionOrDeclarationStatement(ExpressionOrDeclarationStatementAST* node) override {
+      if(node->expressionChosen)
+        visit(node->expression);
+      else
+        visit(node->declaration);
+    }
+
+    virtual void visitSimpleDeclaration(SimpleDeclarationAST* node) override {
+      //Mirrors UseBuilder::visitSimpleDeclaration
+      if(node->init_declarators && node->type_specifier && node->type_specifier->kind != AST::Kind_ClassSpecifier) {
+        evaluate(node);
+        const ListNode<InitDeclaratorAST*> *it = node->init_declarators->toFront(), *end = it;
+        do {
+          if(it->element->declarator && it->element->declarator->id)
+            evaluate(it->element->declarator->id, true);
+          it = it->next;
+        } while (it != end);
+      }else{
+        DefaultVisitor::visitSimpleDeclaration(node);
+      }
+    }
+
+    virtual void visitExpressionStatement(ExpressionStatementAST* node) override { evaluate(node); }
+    virtual void visitBinaryExpression(BinaryExpressionAST* node) override { evaluate(node); }
+    virtual void visitCastExpression(CastExpressionAST* node) override { evaluate(node); }
+    virtual void visitConditionalExpression(ConditionalExpressionAST* node) override { evaluate(node); }
+    virtual void visitCppCastExpression(CppCastExpressionAST* node) override { evaluate(node); }
+    virtual void visitNewExpression(NewExpressionAST* node) override { evaluate(node); }
+    virtual void visitPostfixExpression(PostfixExpressionAST* node) override { evaluate(node); }
+    virtual void visitSizeofExpression(SizeofExpressionAST* node) override { evaluate(node); }
+    virtual void visitSubscriptExpression(SubscriptExpressionAST* node) override { evaluate(node); }
+    virtual void visitUnaryExpression(UnaryExpressionAST* node) override { evaluate(node); }
+    virtual void visitPrimaryExpression(PrimaryExpressionAST* node) override { evaluate(node); }
+    virtual void visitTypeIDOperator(TypeIDOperatorAST* node) override { evaluate(node); }
+    virtual void visitMemInitializer(MemInitializerAST* node) override { evaluate(node); }
+
+  private:
+    void evaluate(AST* node, bool namePrefix = false) {
+      if(!m_context)
+        return;
+
+      UseBuilder::PrefetchedEvaluation& evaluation((*m_results)[node]);
+      evaluation.context = m_context;
+
+      //Reverted by run()
+      node->ducontext = m_context;
+      UseExpressionVisitor visitor(m_session, m_builder, false, false, &evaluation);
+      if(namePrefix)
+        visitor.parseNamePrefix(static_cast<NameAST*>(node));
+      else
+        visitor.parse(node);
+    }
+
+    ParseSession* m_session;
+    UseBuilder* m_builder;
+    UseBuilder::PrefetchedEvaluations* m_results;
+    DUContext* m_context;
 };
 
+///Functor for QtConcurrent, prefetches the expressions of one function definition into a thread-local buffer
+class FunctionBodyPrefetch {
+  public:
+    typedef void result_type;
+
+    FunctionBodyPrefetch(ParseSession* session, UseBuilder* builder, UseBuilder::PrefetchedEvaluations* results, QMutex* resultsMutex)
+      : m_session(session), m_builder(builder), m_results(results), m_resultsMutex(resultsMutex) {
+    }
+
+    void operator()(FunctionDefinitionAST* function) const {
+      UseBuilder::PrefetchedEvaluations results;
+      {
+        //The session's location-table caches positions, so each thread resolves them through its own copy
+        ParseSession::ThreadLocalPositions positions(m_session);
+        Cpp::TypeConversionCacheEnabler enableConversionCache;
+        ExpressionPrefetcher prefetcher(m_session, m_builder, &results);
+        prefetcher.run(function);
+      }
+
+      QMutexLocker lock(m_resultsMutex);
+      m_results->unite(results);
+    }
+
+  private:
+    ParseSession* m_session;
+    UseBuilder* m_builder;
+    UseBuilder::PrefetchedEvaluations* m_results;
+    QMutex* m_resultsMutex;
+};
+
+class FunctionBodyPrefetchRunnable : public QRunnable {
+  public:
+    FunctionBodyPrefetchRunnable(const FunctionBodyPrefetch& prefetch, FunctionDefinitionAST* function)
+      : m_prefetch(prefetch), m_function(function) {
+    }
+
+    virtual void run() override {
+      m_prefetch(m_function);
+    }
+
+  private:
+    FunctionBodyPrefetch m_prefetch;
+    FunctionDefinitionAST* m_function;
+};
+}
+
+void UseBuilder::prefetchFunctionBodies(AST* node)
+{
+  const int threadCount = m_parallelThreadCount ? m_parallelThreadCount : QThread::idealThreadCount();
+  if(threadCount < 2)
+    return;
+
+  FunctionDefinitionCollector collector;
+  collector.visit(node);
+  if(collector.functions.size() < minimumParallelFunctionDefinitions)
+    return;
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threadCount);
+  QMutex resultsMutex;
+  const FunctionBodyPrefetch prefetch(editor()->parseSession(), this, &m_prefetched, &resultsMutex);
+  foreach(FunctionDefinitionAST* function, collector.functions)
+    pool.start(new FunctionBodyPrefetchRunnable(prefetch, function));
+  pool.waitForDone();
+}
+
+bool UseBuilder::replayPrefetched(AST* node, DUContext* context)
+{
+  if(m_prefetched.isEmpty())
+    return false;
+
+  PrefetchedEvaluations::iterator it = m_prefetched.find(node);
+  if(it == m_prefetched.end())
+    return false;
+
+  PrefetchedEvaluation evaluation = *it;
+  m_prefetched.erase(it);
+
+  //Evaluated from a different perspective, the results may differ
+  if(evaluation.context != context)
+    return false;
+
+  ++m_replayedEvaluations;
+  foreach(const PrefetchedUse& use, evaluation.uses)
+    newUse(use.node, use.range, use.declaration);
+  foreach(const QExplicitlySharedDataPointer<KDevelop::Problem>& problem, evaluation.problems)
+    addProblem(problem);
+  return true;
+}
+
 void UseBuilder::visitExpression(AST* node) {
 
-  UseExpressionVisitor visitor( editor()->parseSession(), this, false, m_mapAst );
   if( !node->ducontext )
     node->ducontext = currentContext();
 
+  if(replayPrefetched(node, node->ducontext))
+    return;
+
+  UseExpressionVisitor visitor( editor()->parseSession(), this, false, m_mapAst );
   visitor.parse( node );
 }
 
@@ -213,6 +499,9 @@ void UseBuilder::visitMemInitializer(MemInitializerAST * node)
   if( !node->ducontext )
     node->ducontext = currentContext();
 
+  if(replayPrefetched(node, node->ducontext))
+    return;
+
   UseExpressionVisitor visitor( editor()->parseSession(), this, false, m_mapAst );
 
   visitor.parse( node );
@@ -242,7 +531,6 @@ void UseBuilder::visitSimpleDeclaration(SimpleDeclarationAST* node)
   if(node->init_declarators && node->type_specifier && node->type_specifier->kind != AST::Kind_ClassSpecifier)
   {
     //Overridden so we can build uses for constructors like "A a(3);"
-    UseExpressionVisitor visitor( editor()->parseSession(), this, false, m_mapAst );
     if( !node->ducontext ) {
       if(lastContext() && lastContext()->type() == DUContext::Template && lastContext()->parentContext() == currentContext())
         node->ducontext = lastContext();//Use the template-context so we can build uses for the template-parameters of template functions
@@ -250,7 +538,10 @@ void UseBuilder::visitSimpleDeclaration(SimpleDeclarationAST* node)
         node->ducontext = currentContext();
     }
 
-    visitor.parse( node );
+    if(!replayPrefetched(node, node->ducontext)) {
+      UseExpressionVisitor visitor( editor()->parseSession(), this, false, m_mapAst );
+      visitor.parse( node );
+    }
 
     // Build uses for the name-prefixes of init declarators
     const ListNode<InitDeclaratorAST*>
@@ -261,9 +552,11 @@ void UseBuilder::visitSimpleDeclaration(SimpleDeclarationAST* node)
       InitDeclaratorAST* initDecl = it->element;
       if(initDecl->declarator && initDecl->declarator->id)
       {
-        UseExpressionVisitor visitor( editor()->parseSession(), this, false, m_mapAst );
         initDecl->declarator->id->ducontext = currentContext();
-        visitor.parseNamePrefix(initDecl->declarator->id);
+        if(!replayPrefetched(initDecl->declarator->id, currentContext())) {
+          UseExpressionVisitor visitor( editor()->parseSession(), this, false, m_mapAst );
+          visitor.parseNamePrefix(initDecl->declarator->id);
+        }
       }
       it = it->next;
     } while (it != end);
@@ -23,6 +23,8 @@
 #include "cppduchainexport.h"
 #include <language/duchain/builders/abstractusebuilder.h>
 
+#include <QHash>
+
 class ParseSession;
 
 class UseBuilderBase : public KDevelop::AbstractUseBuilder<AST, NameAST, ContextBuilder> {
@@ -51,9 +53,50 @@ public:
   QList<QExplicitlySharedDataPointer<KDevelop::Problem> > problems() const;
 
   void addProblem(QExplicitlySharedDataPointer<KDevelop::Problem> problem);
-  
+
+  /**
+   * If enabled, the expressions within function definitions are evaluated in parallel
+   * before the uses are built. The sequential pass then only commits the results,
+   * instead of evaluating the expressions itself. Disabled by default.
+   *
+   * Has no effect if the AST is mapped, or if there are only few function definitions.
+   *
+   * @param threadCount The count of threads to evaluate with, zero for QThread::idealThreadCount().
+   *                    Below two threads, nothing is evaluated in parallel.
+   */
+  void setParallelFunctionBodies(bool parallel, int threadCount = 0);
+
+  ///The count of expressions whose parallel evaluation was committed by the last buildUses()
+  int replayedEvaluations() const;
+
+  /**
+   * If set, the bodies of function definitions that do not overlap the lines from @p firstLine to @p lastLine
+   * are skipped, and the existing uses within them are left untouched. The uses in the rest of the definitions,
+   * like the return-type and the qualifier, are still built, since they belong to the surrounding context.
+   * Used to build the uses of the visible part of a document before the whole document. By default, nothing is skipped.
+   */
+  void setLineRange(int firstLine, int lastLine);
+
   using UseBuilderBase::newUse;
 
+  ///A use found while evaluating an expression ahead of the sequential pass
+  struct PrefetchedUse {
+    AST* node;
+    KDevelop::RangeInRevision range;
+    KDevelop::DeclarationPointer declaration;
+  };
+
+  ///The result of evaluating one expression ahead of the sequential pass
+  struct PrefetchedEvaluation {
+    PrefetchedEvaluation() : context(0) {
+    }
+    ///The context the expression was evaluated in
+    KDevelop::DUContext* context;
+    QVector<PrefetchedUse> uses;
+    QList<QExplicitlySharedDataPointer<KDevelop::Problem> > problems;
+  };
+  typedef QHash<AST*, PrefetchedEvaluation> PrefetchedEvaluations;
+
 protected:
   virtual void visitPrimaryExpression (PrimaryExpressionAST*) override;
   virtual void visitMemInitializer(MemInitializerAST *) override;
@@ -88,10 +131,16 @@ protected:
   virtual void visitNamespaceAliasDefinition(NamespaceAliasDefinitionAST* node) override;
   virtual void visitTypeIDOperator(TypeIDOperatorAST* node) override;
   virtual void visitQPropertyDeclaration(QPropertyDeclarationAST* ) override;
+  virtual void visitFunctionDefinition(FunctionDefinitionAST* node) override;
 
 private:
   void buildUsesForName(NameAST* name);
 
+  ///Evaluates the expressions within all function definitions below @p node in parallel
+  void prefetchFunctionBodies(AST* node);
+  ///Commits the prefetched result for @p node if it was evaluated in @p context. Returns whether that was possible.
+  bool replayPrefetched(AST* node, KDevelop::DUContext* context);
+
   void visitExpression(AST* node);
 
   inline int& nextUseIndex() { return m_nextUseStack.top(); }
@@ -101,6 +150,12 @@ private:
   QStack<DUContext*> m_contexts;
 
   QList< QExplicitlySharedDataPointer< KDevelop::Problem > > m_problems;
+
+  bool m_parallelFunctionBodies;
+  int m_parallelThreadCount;
+  int m_replayedEvaluations;
+  int m_firstLine, m_lastLine;
+  PrefetchedEvaluations m_prefetched;
 };
 
 #endif // USEBUILDER_H
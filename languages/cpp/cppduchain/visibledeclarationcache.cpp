@@ -0,0 +1,119 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "visibledeclarationcache.h"
+
+#include <language/duchain/declaration.h>
+#include <language/duchain/topducontext.h>
+
+#include <QCache>
+#include <QMutex>
+
+using namespace KDevelop;
+using namespace Cpp;
+
+namespace {
+
+struct VisibleDeclarationKey
+{
+  IndexedDUContext context;
+  uint source;
+  ///Identifies the range of positions the list is valid for, see positionSignature()
+  QVector<int> positionSignature;
+
+  bool operator==(const VisibleDeclarationKey& rhs) const {
+    return context == rhs.context && source == rhs.source && positionSignature == rhs.positionSignature;
+  }
+};
+
+uint qHash(const VisibleDeclarationKey& key)
+{
+  uint hash = qHash(qMakePair(key.context.hash(), key.source));
+  foreach(int count, key.positionSignature)
+    hash = hash * 31 + count;
+  return hash;
+}
+
+///Count of lists that are remembered, the least recently used are dropped first
+const int maxCachedLists = 500;
+
+QCache<VisibleDeclarationKey, CachedDeclarationList> visibleDeclarationCache(maxCachedLists);
+VisibleDeclarationCache::CacheStatistics visibleDeclarationCacheStatistics;
+QMutex visibleDeclarationCacheMutex;
+
+/**
+ * Counts the declarations and imports of @p context and its parents in front of @p position, once including
+ * and once excluding the ones exactly at the position. Two positions with the same signature see the same declarations.
+ */
+QVector<int> positionSignature(const DUContext* context, const CursorInRevision& position)
+{
+  QVector<int> ret;
+  for(; context; context = context->parentContext()) {
+    int before = 0, upTo = 0;
+    foreach(const Declaration* decl, context->localDeclarations()) {
+      const CursorInRevision start = decl->range().start;
+      if(start < position)
+        ++before;
+      if(start <= position)
+        ++upTo;
+    }
+    ret << before << upTo;
+    before = upTo = 0;
+    foreach(const DUContext::Import& import, context->importedParentContexts()) {
+      if(!import.position.isValid() || import.position < position)
+        ++before;
+      if(!import.position.isValid() || import.position <= position)
+        ++upTo;
+    }
+    ret << before << upTo;
+  }
+  return ret;
+}
+
+}
+
+QList<QPair<Declaration*, int> > VisibleDeclarationCache::allDeclarations(DUContext* context, const CursorInRevision& position, const TopDUContext* source)
+{
+  VisibleDeclarationKey key;
+  key.context = context->indexed();
+  key.source = source ? source->ownIndex() : 0;
+  key.positionSignature = positionSignature(context, position);
+
+  QList<QPair<Declaration*, int> > ret;
+  {
+    QMutexLocker lock(&visibleDeclarationCacheMutex);
+    CachedDeclarationList* cached = visibleDeclarationCache.object(key);
+    if(cached && cached->resolve(ret)) {
+      ++visibleDeclarationCacheStatistics.hits;
+      return ret;
+    }
+    ++visibleDeclarationCacheStatistics.misses;
+  }
+
+  const TopContextRevisions::Snapshot imports = TopContextRevisions::importClosure(context, source);
+  ret = context->allDeclarations(position, source);
+
+  QMutexLocker lock(&visibleDeclarationCacheMutex);
+  visibleDeclarationCache.insert(key, new CachedDeclarationList(ret, imports));
+  return ret;
+}
+
+VisibleDeclarationCache::CacheStatistics VisibleDeclarationCache::cacheStatistics()
+{
+  QMutexLocker lock(&visibleDeclarationCacheMutex);
+  return visibleDeclarationCacheStatistics;
+}
@@ -0,0 +1,51 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef VISIBLEDECLARATIONCACHE_H
+#define VISIBLEDECLARATIONCACHE_H
+
+#include <cppduchainexport.h>
+#include <language/duchain/ducontext.h>
+#include "cacheddeclarationlist.h"
+
+namespace Cpp {
+
+/**
+ * Remembers the list of declarations visible from a context, as needed by the global completion.
+ *
+ * A list is re-used for other positions in the same context, as long as no declaration or import of the
+ * context or its parents lies between the positions, because then the list is the same. Lists are dropped when one of the top-contexts they were collected from is rebuilt,
+ * see TopContextRevisions.
+ */
+class KDEVCPPDUCHAIN_EXPORT VisibleDeclarationCache
+{
+  public:
+    /**
+     * Returns the same as context->allDeclarations(position, source).
+     * @warning The DUChain must be read-locked
+     */
+    static QList<QPair<KDevelop::Declaration*, int> > allDeclarations(KDevelop::DUContext* context, const KDevelop::CursorInRevision& position, const KDevelop::TopDUContext* source);
+
+    typedef DeclarationCacheStatistics CacheStatistics;
+
+    ///Returns how often a remembered list could be used since the application was started
+    static CacheStatistics cacheStatistics();
+};
+
+}
+
+#endif // VISIBLEDECLARATIONCACHE_H
@@ -0,0 +1,137 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "writelockstatistics.h"
+
+#include <language/duchain/duchain.h>
+
+#include <QThreadStorage>
+
+using namespace KDevelop;
+
+namespace {
+struct CurrentHistogram
+{
+  CurrentHistogram() : histogram(0) {
+  }
+  Cpp::WriteLockHistogram* histogram;
+};
+
+QThreadStorage<CurrentHistogram> currentHistograms;
+}
+
+namespace Cpp {
+
+WriteLockHistogram::WriteLockHistogram()
+  : m_sections(0)
+  , m_total(0)
+  , m_maximum(0)
+{
+  for(int a = 0; a < BucketCount; ++a)
+    m_buckets[a] = 0;
+}
+
+qint64 WriteLockHistogram::bucketLimit(int bucket)
+{
+  static const qint64 limits[BucketCount - 1] = {1, 5, 20, 100, 500};
+  return limits[bucket];
+}
+
+void WriteLockHistogram::record(qint64 nsecs)
+{
+  const qint64 msecs = nsecs / 1000000;
+  int bucket = 0;
+  while(bucket < BucketCount - 1 && msecs >= bucketLimit(bucket))
+    ++bucket;
+  ++m_buckets[bucket];
+  ++m_sections;
+  m_total += nsecs;
+  m_maximum = qMax(m_maximum, nsecs);
+}
+
+uint WriteLockHistogram::sections() const
+{
+  return m_sections;
+}
+
+QString WriteLockHistogram::toString() const
+{
+  QString ret = QStringLiteral("%1 sections, %2 ms total, %3 ms max |").arg(m_sections).arg(m_total / 1000000.0, 0, 'f', 2).arg(m_maximum / 1000000.0, 0, 'f', 2);
+  for(int a = 0; a < BucketCount; ++a) {
+    if(a < BucketCount - 1)
+      ret += QStringLiteral(" <%1ms: %2").arg(bucketLimit(a)).arg(m_buckets[a]);
+    else
+      ret += QStringLiteral(" >=%1ms: %2").arg(bucketLimit(a - 1)).arg(m_buckets[a]);
+  }
+  return ret;
+}
+
+WriteLockHistogram* WriteLockHistogram::current()
+{
+  return currentHistograms.localData().histogram;
+}
+
+WriteLockHistogram::Recording::Recording(WriteLockHistogram* histogram)
+  : m_previous(current())
+{
+  currentHistograms.localData().histogram = histogram;
+}
+
+WriteLockHistogram::Recording::~Recording()
+{
+  currentHistograms.localData().histogram = m_previous;
+}
+
+TimedWriteLocker::TimedWriteLocker()
+  : m_lock(DUChain::lock())
+{
+  if(WriteLockHistogram::current())
+    m_timer.start();
+}
+
+TimedWriteLocker::~TimedWriteLocker()
+{
+  unlock();
+}
+
+bool TimedWriteLocker::lock()
+{
+  const bool ret = m_lock.lock();
+  if(ret && WriteLockHistogram::current())
+    m_timer.start();
+  return ret;
+}
+
+void TimedWriteLocker::unlock()
+{
+  if(!m_lock.locked())
+    return;
+  if(m_timer.isValid()) {
+    //The histogram may have changed meanwhile, it is only recorded if there still is one
+    if(WriteLockHistogram* histogram = WriteLockHistogram::current())
+      histogram->record(m_timer.nsecsElapsed());
+    m_timer.invalidate();
+  }
+  m_lock.unlock();
+}
+
+bool TimedWriteLocker::locked() const
+{
+  return m_lock.locked();
+}
+
+}
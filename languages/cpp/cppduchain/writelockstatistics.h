@@ -0,0 +1,99 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef WRITELOCKSTATISTICS_H
+#define WRITELOCKSTATISTICS_H
+
+#include <cppduchainexport.h>
+#include <language/duchain/duchainlock.h>
+
+#include <QElapsedTimer>
+#include <QString>
+
+namespace Cpp {
+
+/**
+ * Histogram of the time the DUChain write-lock is held per critical section.
+ * While it is held, highlighting, navigation and code-completion in the UI are blocked.
+ */
+class KDEVCPPDUCHAIN_EXPORT WriteLockHistogram
+{
+  public:
+    WriteLockHistogram();
+
+    void record(qint64 nsecs);
+
+    ///The count of recorded sections
+    uint sections() const;
+
+    QString toString() const;
+
+    ///The histogram the TimedWriteLocker sections of the current thread are recorded into, or zero
+    static WriteLockHistogram* current();
+
+    /**
+     * While an instance exists, the TimedWriteLocker sections of the creating thread are recorded into @p histogram.
+     * Instances may be nested, the previous histogram is used again when the inner one is destroyed.
+     */
+    class KDEVCPPDUCHAIN_EXPORT Recording
+    {
+      public:
+        explicit Recording(WriteLockHistogram* histogram);
+        ~Recording();
+
+      private:
+        Q_DISABLE_COPY(Recording)
+        WriteLockHistogram* m_previous;
+    };
+
+  private:
+    enum {
+      BucketCount = 6
+    };
+
+    ///Upper limit of the given bucket in milliseconds. The last bucket has no limit.
+    static qint64 bucketLimit(int bucket);
+
+    uint m_buckets[BucketCount];
+    uint m_sections;
+    qint64 m_total;
+    qint64 m_maximum;
+};
+
+/**
+ * Same as DUChainWriteLocker, but records the time the lock is held, excluding the time waiting for it,
+ * into the histogram of the current thread. Does not record anything if no histogram is set.
+ */
+class KDEVCPPDUCHAIN_EXPORT TimedWriteLocker
+{
+  public:
+    TimedWriteLocker();
+    ~TimedWriteLocker();
+
+    bool lock();
+    void unlock();
+    bool locked() const;
+
+  private:
+    Q_DISABLE_COPY(TimedWriteLocker)
+    KDevelop::DUChainWriteLocker m_lock;
+    QElapsedTimer m_timer;
+};
+
+}
+
+#endif // WRITELOCKSTATISTICS_H
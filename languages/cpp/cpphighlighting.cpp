@@ -22,9 +22,121 @@
 
 #include "cpphighlighting.h"
 
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainutils.h>
+#include <language/duchain/declaration.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/topducontext.h>
+#include <language/duchain/use.h>
+#include <language/highlighting/colorcache.h>
+#include <interfaces/icore.h>
+#include <interfaces/idocument.h>
+#include <interfaces/idocumentcontroller.h>
+
+using namespace KDevelop;
+
+namespace {
+
+void combine(quint64& hash, quint64 value)
+{
+  //64-bit mixing, so that different highlightings practically never share a fingerprint
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+}
+
+void combine(quint64& hash, const RangeInRevision& range)
+{
+  combine(hash, (quint64(range.start.line) << 32) | uint(range.start.column));
+  combine(hash, (quint64(range.end.line) << 32) | uint(range.end.column));
+}
+
+void fingerprintContext(const DUContext* context, const TopDUContext* top, quint64& hash)
+{
+  combine(hash, context->type());
+  combine(hash, context->range());
+
+  foreach(const Declaration* decl, context->localDeclarations()) {
+    combine(hash, decl->range());
+    combine(hash, decl->kind());
+    combine(hash, decl->indexedType().hash());
+    combine(hash, decl->id().hash());
+  }
+
+  const Use* uses = context->uses();
+  for(int a = 0; a < context->usesCount(); ++a) {
+    combine(hash, uses[a].m_range);
+    combine(hash, top->usedDeclarationIdForIndex(uses[a].m_declarationIndex).hash());
+  }
+
+  foreach(const DUContext* child, context->childContexts())
+    fingerprintContext(child, top, hash);
+}
+
+}
+
 CppHighlighting::CppHighlighting(QObject* parent)
   : KDevelop::CodeHighlighting(parent)
 {
+  connect(ColorCache::self(), &ColorCache::colorsGotChanged, this, &CppHighlighting::colorsGotChanged);
+  if(ICore::self())
+    connect(ICore::self()->documentController(), &IDocumentController::documentClosed, this, &CppHighlighting::documentClosed);
+}
+
+quint64 CppHighlighting::highlightingFingerprint(const TopDUContext* context)
+{
+  quint64 hash = 0;
+  fingerprintContext(context, context, hash);
+
+  //The highlighting of uses also depends on the kinds of the imported declarations, which only change with the imported files
+  foreach(const DUContext::Import& import, context->importedParentContexts()) {
+    DUContext* imported = import.context(context);
+    if(!imported)
+      continue;
+    combine(hash, imported->topContext()->ownIndex());
+    ParsingEnvironmentFilePointer file = imported->topContext()->parsingEnvironmentFile();
+    if(file) {
+      const ModificationRevision revision = file->modificationRevision();
+      combine(hash, (quint64(revision.modificationTime) << 32) | uint(revision.revision));
+    }
+  }
+  return hash;
+}
+
+void CppHighlighting::highlightDUChain(ReferencedTopDUContext context)
+{
+  IndexedString url;
+  quint64 fingerprint = 0;
+  {
+    DUChainReadLocker lock;
+    TopDUContext* content = DUChainUtils::contentContextFromProxyContext(context.data());
+    if(!content)
+      return;
+    url = content->url();
+    fingerprint = highlightingFingerprint(content);
+  }
+
+  {
+    QMutexLocker lock(&m_fingerprintsMutex);
+    QHash<IndexedString, quint64>::const_iterator it = m_fingerprints.constFind(url);
+    //The highlighting is gone when the document was closed, so it also has to be re-done then
+    if(it != m_fingerprints.constEnd() && *it == fingerprint && hasHighlighting(url))
+      return;
+    m_fingerprints.insert(url, fingerprint);
+  }
+
+  KDevelop::CodeHighlighting::highlightDUChain(context);
+}
+
+void CppHighlighting::colorsGotChanged()
+{
+  QMutexLocker lock(&m_fingerprintsMutex);
+  m_fingerprints.clear();
+}
+
+void CppHighlighting::documentClosed(IDocument* document)
+{
+  QMutexLocker lock(&m_fingerprintsMutex);
+  m_fingerprints.remove(IndexedString(document->url()));
 }
 
 
@@ -24,7 +24,14 @@
 #define KDEVCPPHIGHLIGHTING_H
 
 #include <language/highlighting/codehighlighting.h>
+#include <serialization/indexedstring.h>
 
+#include <QHash>
+#include <QMutex>
+
+namespace KDevelop {
+class IDocument;
+}
 
 class CppHighlighting : public KDevelop::CodeHighlighting
 {
@@ -32,6 +39,24 @@ class CppHighlighting : public KDevelop::CodeHighlighting
 public:
   CppHighlighting(QObject* parent);
 
+  /**
+   * Only re-highlights the document if anything the highlighting depends on changed since it was highlighted last time.
+   * A reparse without semantic changes, for example when saving, then does not push all ranges to the editor again.
+   * If anything changed, the whole document is highlighted again, single ranges are not updated.
+   * */
+  void highlightDUChain(KDevelop::ReferencedTopDUContext context) override;
+
+  ///Hash over the ranges, kinds and types of the declarations and uses in @p context. @warning The du-chain must be locked
+  static quint64 highlightingFingerprint(const KDevelop::TopDUContext* context);
+
+private slots:
+  void colorsGotChanged();
+  void documentClosed(KDevelop::IDocument* document);
+
+private:
+  QMutex m_fingerprintsMutex;
+  ///Fingerprints of the currently highlighted documents, dropped when they are closed
+  QHash<KDevelop::IndexedString, quint64> m_fingerprints;
 };
 
 #endif
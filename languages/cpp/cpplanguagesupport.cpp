@@ -77,6 +77,9 @@
 #include "environmentmanager.h"
 #include "cppduchain/navigation/navigationwidget.h"
 #include "cppduchain/cppduchain.h"
+#include "cppduchain/documentsnapshot.h"
+#include "cppduchain/globalsymbolindex.h"
+#include "cppduchain/proxycontextstatistics.h"
 //#include "codegen/makeimplementationprivate.h"
 #include "codegen/adaptsignatureassistant.h"
 #include "codegen/unresolvedincludeassistant.h"
@@ -86,6 +89,7 @@
 #include "codegen/simplerefactoring.h"
 #include "codegen/cppclasshelper.h"
 #include "includepathcomputer.h"
+#include "parsescheduler.h"
 #include "debug.h"
 
 //#include <valgrind/callgrind.h>
@@ -198,6 +202,20 @@ CppLanguageSupport::CppLanguageSupport( QObject* parent, const QVariantList& /*a
         quickOpen->registerProvider( IncludeFileDataProvider::scopes(), QStringList(i18n("Files")), m_quickOpenDataProvider );
     // else we are in NoUi mode (duchainify, unit tests, ...) and hence cannot find the Quickopen plugin
 
+    new ParseScheduler(this);
+
+    //The missing-include completion finds the symbols of the project files before they are parsed again
+    connect(core()->projectController(), &IProjectController::projectOpened, this, [] (IProject* project) {
+      Cpp::GlobalSymbolIndex::ensureDocumentsInBackground(project->fileSet());
+    });
+    foreach(IProject* project, core()->projectController()->projects())
+      Cpp::GlobalSymbolIndex::ensureDocumentsInBackground(project->fileSet());
+
+    //The snapshots are only needed while the editor shows the document
+    connect(core()->documentController(), &IDocumentController::documentClosed, this, [] (IDocument* document) {
+      Cpp::DocumentSnapshot::remove(IndexedString(document->url()));
+    });
+
 #ifdef DEBUG_UI_LOCKUP
     new UIBlockTester(LOCKUP_INTERVAL, this);
 #endif
@@ -241,6 +259,7 @@ CppLanguageSupport::~CppLanguageSupport()
     }
 
     delete m_quickOpenDataProvider;
+    Cpp::ProxyContextStatistics::writeReport();
 #ifdef DEBUG_UI_LOCKUP
     delete m_blockTester;
 #endif
@@ -466,24 +485,22 @@ QPair<QPair<QString, KTextEditor::Range>, QString> CppLanguageSupport::cursorIde
   return qMakePair( qMakePair(line.mid(start, end-start), wordRange), line.mid(end) );
 }
 
-QPair<TopDUContextPointer, KTextEditor::Range> CppLanguageSupport::importedContextForPosition(const QUrl &url, const KTextEditor::Cursor& position) {
-  QPair<QPair<QString, KTextEditor::Range>, QString> found = cursorIdentifier(url, position);
-  if(!found.first.second.isValid())
-    return qMakePair(TopDUContextPointer(), KTextEditor::Range::invalid());
-
-  QString word(found.first.first);
-  KTextEditor::Range wordRange(found.first.second);
+namespace {
+///Returns the range of the file-name within the include-line @p line that covers @p lineRange
+KTextEditor::Range includeFileRange(const QString& line, const KTextEditor::Range& lineRange)
+{
+  KTextEditor::Range wordRange(lineRange);
 
   int pos = 0;
-  for(; pos < word.size(); ++pos) {
-    if(word[pos] == '"' || word[pos] == '<') {
+  for(; pos < line.size(); ++pos) {
+    if(line[pos] == '"' || line[pos] == '<') {
       wordRange.start() = wordRange.start() + KTextEditor::Cursor(0, ++pos);
       break;
     }
   }
 
-  for(; pos < word.size(); ++pos) {
-    if(word[pos] == '"' || word[pos] == '>') {
+  for(; pos < line.size(); ++pos) {
+    if(line[pos] == '"' || line[pos] == '>') {
       wordRange.end() = KTextEditor::Cursor(wordRange.end().line(), pos);
       break;
     }
@@ -491,6 +508,17 @@ QPair<TopDUContextPointer, KTextEditor::Range> CppLanguageSupport::importedConte
 
   if(wordRange.start() > wordRange.end())
     wordRange.start() = wordRange.end();
+  return wordRange;
+}
+}
+
+QPair<TopDUContextPointer, KTextEditor::Range> CppLanguageSupport::importedContextForPosition(const QUrl &url, const KTextEditor::Cursor& position) {
+  QPair<QPair<QString, KTextEditor::Range>, QString> found = cursorIdentifier(url, position);
+  if(!found.first.second.isValid())
+    return qMakePair(TopDUContextPointer(), KTextEditor::Range::invalid());
+
+  QString word(found.first.first);
+  KTextEditor::Range wordRange = includeFileRange(word, found.first.second);
 
   //Since this is called by the editor while editing, use a fast timeout so the editor stays responsive
   DUChainReadLocker lock(DUChain::lock(), 100);
@@ -578,6 +606,26 @@ QPair<KTextEditor::Range, const rpp::pp_macro> CppLanguageSupport::usedMacroForP
 
 KTextEditor::Range CppLanguageSupport::specialLanguageObjectRange(const QUrl &url, const KTextEditor::Cursor& position) {
 
+  //This is called by the editor on every mouse move, so answer from the snapshot of the last parse when there is one,
+  //instead of waiting for the DUChain lock while a background parse holds it
+  Cpp::DocumentSnapshot::Ptr snapshot = Cpp::DocumentSnapshot::forDocument(IndexedString(url));
+  if(snapshot) {
+    QPair<QPair<QString, KTextEditor::Range>, QString> found = cursorIdentifier(url, position);
+    const QString& word(found.first.first);
+    if(!found.first.second.isValid() || word.isEmpty())
+      return KTextEditor::Range::invalid();
+
+    if(CppUtils::findEndOfInclude(word) != -1) {
+      if(snapshot->includes.contains(found.first.second.start().line()))
+        return includeFileRange(word, found.first.second);
+      return KTextEditor::Range::invalid();
+    }
+
+    if(snapshot->macros.contains(IndexedString(word)))
+      return found.first.second;
+    return KTextEditor::Range::invalid();
+  }
+
   QPair<TopDUContextPointer, KTextEditor::Range> import = importedContextForPosition(url, position);
   if(import.first)
     return import.second;
@@ -26,6 +26,8 @@
 #include "cpplanguagesupport.h"
 #include "cpphighlighting.h"
 #include "includepathcomputer.h"
+#include "includedirectoryindex.h"
+#include "codecompletion/context.h"
 
 #include "parser/parser.h"
 #include "parser/control.h"
@@ -36,6 +38,8 @@
 #include <QByteArray>
 #include <QReadWriteLock>
 #include <QReadLocker>
+#include <QThread>
+#include <QCoreApplication>
 
 #include <KLocalizedString>
 
@@ -45,6 +49,13 @@
 #include "cppduchain/cppeditorintegrator.h"
 #include "cppduchain/declarationbuilder.h"
 #include "cppduchain/usebuilder.h"
+#include "cppduchain/adlhelper.h"
+#include "cppduchain/topcontextrevisions.h"
+#include "cppduchain/documentsnapshot.h"
+#include "cppduchain/globalsymbolindex.h"
+#include "cppduchain/proxycontextstatistics.h"
+#include "cppduchain/writelockstatistics.h"
+#include "cppduchain/visibledeclarationcache.h"
 #include "preprocessjob.h"
 #include "environmentmanager.h"
 #include "debug.h"
@@ -65,6 +76,9 @@
 #include <interfaces/iuicontroller.h>
 #include <interfaces/icore.h>
 #include <interfaces/ilanguagecontroller.h>
+#include <interfaces/idocumentcontroller.h>
+#include <KTextEditor/Document>
+#include <KTextEditor/View>
 #include <cpppreprocessenvironment.h>
 #include <language/checks/dataaccessrepository.h>
 #include <language/checks/controlflowgraph.h>
@@ -116,6 +130,33 @@ void CPPParseJob::setNeedUpdateEverything(bool need) {
   m_needUpdateEverything = need;
 }
 
+namespace {
+///Documents with fewer lines are highlighted fast enough as a whole
+const int minimumLinesForVisibleFirst = 2000;
+///Lines above and below the visible ones that are built together with them
+const int visibleLinesMargin = 50;
+
+/**
+ * Returns the lines shown by the active view of the document, widened by visibleLinesMargin, or an invalid range if it is not shown.
+ * Must be called from the foreground thread.
+ */
+KTextEditor::Range visibleLines(const IndexedString& document)
+{
+  IDocument* doc = ICore::self()->documentController()->documentForUrl(document.toUrl());
+  KTextEditor::View* view = doc ? doc->activeTextView() : 0;
+  if(!view || !view->isVisible())
+    return KTextEditor::Range::invalid();
+
+  KTextEditor::Cursor first = view->coordinatesToCursor(QPoint(view->width() / 2, 0));
+  KTextEditor::Cursor last = view->coordinatesToCursor(QPoint(view->width() / 2, view->height() - 1));
+  if(!first.isValid())
+    return KTextEditor::Range::invalid();
+  if(!last.isValid())
+    last = view->document()->documentEnd();
+  return KTextEditor::Range(qMax(0, first.line() - visibleLinesMargin), 0, last.line() + visibleLinesMargin, 0);
+}
+}
+
 CPPParseJob::CPPParseJob( const IndexedString& url, ILanguageSupport* languageSupport,
                     PreprocessJob* parentPreprocessor )
         : KDevelop::ParseJob( url, languageSupport ),
@@ -126,11 +167,15 @@ CPPParseJob::CPPParseJob( const IndexedString& url, ILanguageSupport* languageSu
         m_includePathsComputed( 0 ),
         m_keepDuchain( false ),
         m_parsedIncludes( 0 ),
-        m_needsUpdate( true )
+        m_needsUpdate( true ),
+        m_visibleLines( KTextEditor::Range::invalid() )
 {
     if( !m_parentPreprocessor ) {
         addJob(m_preprocessJob = ThreadWeaver::JobPointer(new PreprocessJob(this)));
         addJob(m_parseJob = ThreadWeaver::JobPointer(new CPPInternalParseJob(this)));
+        //The views can only be asked from the foreground, where the background-parser creates the jobs
+        if( QThread::currentThread() == QCoreApplication::instance()->thread() )
+            m_visibleLines = visibleLines(url);
     } else {
         m_preprocessJob.clear();
         m_parseJob.clear();
@@ -259,6 +304,13 @@ const QList<IndexedString>& CPPParseJob::indexedIncludePaths() const {
             m_includePathUrls = m_includePathsComputed->result();
             m_includePaths = convertFromPaths(m_includePathUrls);
 
+            //Include-completion and the missing-include search will list these directories
+            QStringList includeDirectories;
+            foreach (const Path& path, m_includePathUrls) {
+              includeDirectories << path.toLocalFile();
+            }
+            CppUtils::IncludeDirectoryIndex::self()->prefetch(includeDirectories);
+
         }
         return m_includePaths;
     } else {
@@ -360,6 +412,11 @@ const KTextEditor::Range& CPPParseJob::textRangeToParse() const
     return m_textRangeToParse;
 }
 
+const KTextEditor::Range& CPPParseJob::visibleLines() const
+{
+    return m_visibleLines;
+}
+
 CPPInternalParseJob::CPPInternalParseJob(CPPParseJob * parent)
     : m_parentJob(parent)
     , m_initialized(false)
@@ -417,6 +474,35 @@ void CPPInternalParseJob::highlightIfNeeded()
     l.unlock();
     if ( parentJob()->cpp() && parentJob()->cpp()->codeHighlighting() )
       parentJob()->cpp()->codeHighlighting()->highlightDUChain( standardContext.data() );
+
+    //Prepare the completion at the cursor, so the first completion after opening a file does not have to compute everything
+    Cpp::CodeCompletionContext::prewarm(parentJob()->document());
+}
+
+namespace {
+/**
+ * Records the write-lock sections of one parse-job, including those of the builders, and writes
+ * the histogram to the debug output when the job leaves run(), on every path
+ */
+class WriteLockHistogramReporter
+{
+public:
+  explicit WriteLockHistogramReporter(const IndexedString& document)
+    : m_document(document)
+    , m_recording(&m_histogram)
+  {
+  }
+
+  ~WriteLockHistogramReporter() {
+    if(CPP().isDebugEnabled())
+      qCDebug(CPP) << "DUChain write-lock held for" << m_document.str() << ":" << m_histogram.toString();
+  }
+
+private:
+  IndexedString m_document;
+  Cpp::WriteLockHistogram m_histogram;
+  Cpp::WriteLockHistogram::Recording m_recording;
+};
 }
 
 void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Thread* thread)
@@ -432,6 +518,8 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
 
     initialize();
 
+    WriteLockHistogramReporter lockReporter(parentJob()->document());
+
     if(updatingContentContext)
       parentJob()->translateDUChainToRevision(updatingContentContext.data());
 
@@ -443,6 +531,8 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
     if(!parentJob()->needsUpdate()) {
       parentJob()->processDelayedImports();
       qCDebug(CPP) << "===-- ALREADY UP TO DATE --===> " << parentJob()->document().str();
+      //Files loaded from the DUChain of an earlier session have to be indexed as well
+      Cpp::GlobalSymbolIndex::updateDocument(parentJob()->document());
       highlightIfNeeded();
       return;
     }
@@ -472,7 +562,7 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
       * If simplified environment-matching is disabled, always remove the imports if the file is reparsed,
       * their new versions will be re-added.
       * */
-        DUChainWriteLocker lock(DUChain::lock());
+        Cpp::TimedWriteLocker lock;
       if(!parentJob()->keepDuchain() &&
         ((!parentJob()->masterJob()->wasUpdated(contentContext) && parentJob()->needUpdateEverything())
           || !proxyContext))
@@ -564,7 +654,7 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
         //This will be set to true if the duchain data should be left untouched
         if((ast->hadMissingCompoundTokens || control.hasProblem(IProblem::Lexer)) && updatingContentContext) {
           //Make sure we don't update into a completely invalid state where everything is invalidated temporarily.
-          DUChainWriteLocker l(DUChain::lock());
+          Cpp::TimedWriteLocker l;
 
           if((updatingContentContext->features() & parentJob()->minimumFeatures()) ==  parentJob()->minimumFeatures() &&
             isOpenInEditor &&
@@ -596,7 +686,7 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
 
       uint oldItemCount = 0;
       if(contentContext) {
-        DUChainWriteLocker l(DUChain::lock());
+        Cpp::TimedWriteLocker l;
         contentContext->clearProblems();
         oldItemCount = contentContext->childContexts().size() + contentContext->localDeclarations().size();
       }
@@ -623,13 +713,17 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
       if(!doNotChangeDUChain) {
 
         if(Cpp::EnvironmentManager::self()->matchingLevel() == Cpp::EnvironmentManager::Disabled) {
-            DUChainWriteLocker lock(DUChain::lock());
+            Cpp::TimedWriteLocker lock;
             if(contentContext)
               contentContext->clearImportedParentContexts();
         }
 
         contentContext = declarationBuilder.buildDeclarations(contentEnvironmentFile, ast, &importedContentChains, contentContext, false);
 
+        //The types used from within this context and its importers may now resolve to different declarations
+        Cpp::TopContextRevisions::bump(contentContext->indexed());
+        Cpp::ADLHelper::invalidateCache(contentContext->indexed());
+
         //If publically visible declarations were added/removed, all following parsed files need to be updated
         if(declarationBuilder.changeWasSignificant()) {
           ///@todo The right solution to the whole problem: Do not put any imports into the content-contexts. Instead, Represent the complete import-structure in the proxy-contexts.
@@ -655,7 +749,7 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
       }
 
       {
-        DUChainWriteLocker l(DUChain::lock());
+        Cpp::TimedWriteLocker l;
 
         foreach( const ProblemPointer& problem, parentJob()->preprocessorProblems() ) {
           contentContext->addProblem(problem);
@@ -666,50 +760,74 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
         }
       }
 
-      if(!doNotChangeDUChain) {
-        if(contentContext) {
-            DUChainWriteLocker l(DUChain::lock());
-            QList<TopDUContext*> remove;
-            foreach(const ReferencedTopDUContext &ctx, importedTemporaryChains)
-                remove << ctx.data();
-            contentContext->removeImportedParentContexts(remove);
+      //The sections below are kept separate, so other threads get the lock in between
+      if(!doNotChangeDUChain && contentContext) {
+        {
+          QList<TopDUContext*> remove;
+          foreach(const ReferencedTopDUContext &ctx, importedTemporaryChains)
+              remove << ctx.data();
+
+          //Remove the temporary chains first, so we don't get warnings from them
+          Cpp::TimedWriteLocker l;
+          contentContext->removeImportedParentContexts(remove);
         }
 
         ///When simplified environment-matching is enabled, we will accumulate many different
         ///versions of imports into a single top-context. To reduce that a little, we remove all
         ///with urls we didn't encounter.
         if(updatingContentContext) {
-            DUChainWriteLocker l(DUChain::lock());
-
-            //Remove the temporary chains first, so we don't get warnings from them
-
+          Cpp::TimedWriteLocker l;
+          if(contentEnvironmentFile->missingIncludeFiles().set().count() == 0 && (!proxyEnvironmentFile || proxyEnvironmentFile->missingIncludeFiles().set().count() == 0)) {
             QVector<DUContext::Import> imports = contentContext->importedParentContexts();
             foreach(const DUContext::Import &ctx, imports) {
-                if(ctx.context(0) && !encounteredIncludeUrls.contains(ctx.context(0)->url()) && contentEnvironmentFile->missingIncludeFiles().set().count() == 0 && (!proxyEnvironmentFile || proxyEnvironmentFile->missingIncludeFiles().set().count() == 0)) {
+                if(ctx.context(0) && !encounteredIncludeUrls.contains(ctx.context(0)->url())) {
                     contentContext->removeImportedParentContext(ctx.context(0));
                     qCDebug(CPP) << "removing not encountered import " << ctx.context(0)->url().str();
                 }
             }
+          }
         }
 
-        if(contentContext) {
-          DUChainWriteLocker l(DUChain::lock());
+        {
+          Cpp::TimedWriteLocker l;
           contentContext->updateImportsCache();
         }
+      }
 
+      if(!doNotChangeDUChain) {
         if (!parentJob()->abortRequested()) {
           if ((newFeatures & TopDUContext::AllDeclarationsContextsAndUses) == TopDUContext::AllDeclarationsContextsAndUses) {
               parentJob()->setLocalProgress(0.5, i18n("Building uses"));
 
+              const KTextEditor::Range visible = parentJob()->visibleLines();
+              if(isOpenInEditor && !keepAST && visible.isValid()) {
+                //Build and highlight the uses of the visible part of large documents first, so they are shown without waiting for the rest.
+                //The content-context is highlighted directly, so this also works on first open, before the features are set
+                //and the proxy-context exists. Outside the visible part the uses are then missing, or the previous ones on an update.
+                int lineCount = 0;
+                {
+                  DUChainReadLocker l(DUChain::lock());
+                  lineCount = contentContext->range().end.line;
+                }
+                if(lineCount >= minimumLinesForVisibleFirst && (visible.start().line() > 0 || visible.end().line() < lineCount)) {
+                  UseBuilder visibleUseBuilder(parentJob()->parseSession().data());
+                  visibleUseBuilder.setLineRange(visible.start().line(), visible.end().line());
+                  visibleUseBuilder.buildUses(ast);
+                  if (!parentJob()->abortRequested() && parentJob()->cpp() && parentJob()->cpp()->codeHighlighting())
+                    parentJob()->cpp()->codeHighlighting()->highlightDUChain( contentContext );
+                }
+              }
+
               UseBuilder useBuilder(parentJob()->parseSession().data());
               useBuilder.setMapAst(keepAST);
+              useBuilder.setParallelFunctionBodies(true);
               useBuilder.buildUses(ast);
-              DUChainWriteLocker l(DUChain::lock());
+              Cpp::TimedWriteLocker l;
               foreach(KDevelop::ProblemPointer problem, useBuilder.problems())
                 contentContext->addProblem(problem);
           }else{
               //Delete existing uses
-              DUChainWriteLocker lock( DUChain::lock() );
+              Cpp::TimedWriteLocker lock;
               contentContext->deleteUsesRecursively();
           }
         }
@@ -725,7 +843,7 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
 
       ///Now mark the context as not being updated. This MUST be done or we will be waiting forever in a loop
       {
-        DUChainWriteLocker l(DUChain::lock());
+        Cpp::TimedWriteLocker l;
         contentContext->setFeatures(newFeatures);
         if(proxyContext)
           proxyContext->setFeatures(newFeatures);
@@ -742,12 +860,15 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
           contentContext->clearAst();
       }
 
+      //The code-model now reflects the new declarations
+      Cpp::GlobalSymbolIndex::updateDocument(parentJob()->document());
+
       if (parentJob()->abortRequested())
         return /*parentJob()->abortJob()*/;
 
     }else{
       {
-        DUChainWriteLocker l(DUChain::lock());
+        Cpp::TimedWriteLocker l;
         if(proxyContext && contentContext)
           proxyContext->setFeatures(contentContext->features());
       }
@@ -758,7 +879,7 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
     //Even if doNotChangeDUChain is enabled, add new imported contexts.
     //This is very useful so new added includes always work.
     if(parentJob()->keepDuchain() || doNotChangeDUChain) {
-      DUChainWriteLocker l(DUChain::lock());
+      Cpp::TimedWriteLocker l;
       ///Add all our imports to the re-used context, just to make sure they are there.
       foreach( const LineContextPair& import, importedContentChains )
           if(!import.temporary)
@@ -786,14 +907,18 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
     if( proxyEnvironmentFile ) {
         ContextBuilder builder(parentJob()->parseSession().data());
         if(Cpp::EnvironmentManager::self()->matchingLevel() == Cpp::EnvironmentManager::Disabled) {
-            DUChainWriteLocker lock(DUChain::lock());
+            Cpp::TimedWriteLocker lock;
             if(updatingProxyContext)
               updatingProxyContext->clearImportedParentContexts();
         }
 
         proxyContext = builder.buildProxyContextFromContent(proxyEnvironmentFile, TopDUContextPointer(contentContext), TopDUContextPointer(updatingProxyContext));
+        if(!updatingProxyContext)
+          Cpp::ProxyContextStatistics::proxyContextCreated(parentJob()->document());
+        Cpp::TopContextRevisions::bump(proxyContext->indexed());
+        Cpp::ADLHelper::invalidateCache(proxyContext->indexed());
 
-        DUChainWriteLocker lock(DUChain::lock());
+        Cpp::TimedWriteLocker lock;
 
         Q_ASSERT(!updatingProxyContext || updatingProxyContext == proxyContext);
 
@@ -829,7 +954,7 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
 
     {
       //Update include-path dependencies
-      DUChainWriteLocker lock(DUChain::lock());
+      Cpp::TimedWriteLocker lock;
       if(proxyEnvironmentFile)
         proxyEnvironmentFile->setIncludePathDependencies(parentJob()->includePathDependencies());
 
@@ -845,6 +970,14 @@ void CPPInternalParseJob::run(ThreadWeaver::JobPointer pointer, ThreadWeaver::Th
 
     parentJob()->setDuChain(proxyContext ? proxyContext : contentContext);
 
+    //Publish what the editor asks for while hovering, so it can be answered without the DUChain lock
+    if(ICore::self()->languageController()->backgroundParser()->trackerForUrl(parentJob()->document())) {
+      DUChainReadLocker lock(DUChain::lock());
+      Cpp::DocumentSnapshot::publish(contentContext.data(), proxyContext ? proxyContext.data() : contentContext.data());
+    }else{
+      Cpp::DocumentSnapshot::remove(parentJob()->document());
+    }
+
     //Indicate progress
     parentJob()->setLocalProgress(1, i18n("Ready"));
 
@@ -103,6 +103,9 @@ public:
 
     const KTextEditor::Range& textRangeToParse() const;
 
+    ///The lines of the document shown when the job was created, plus some margin, or an invalid range if it was not shown
+    const KTextEditor::Range& visibleLines() const;
+
     /**
      * Get/set the environment-file of the proxy-context, if simpified matching is used.
      * When simplified-matching is used, two separate contexts will be created, with separate environment-descriptions.
@@ -180,6 +183,8 @@ public:
     
     KDevelop::ModificationRevisionSet includePathDependencies() const ;
     
+    //The control-flow graph and the data-access information are only built when the platform asks for them,
+    //which it does only for language checks. Nothing in this plugin consumes them per function.
     virtual ControlFlowGraph* controlFlowGraph() override;
     virtual DataAccessRepository* dataAccessInformation() override;
 private:
@@ -224,6 +229,7 @@ private:
     mutable QMutex m_waitForIncludePathsMutex;
     mutable QWaitCondition m_waitForIncludePaths;
     bool m_needsUpdate;
+    KTextEditor::Range m_visibleLines;
 };
 
 class CPPInternalParseJob : public ThreadWeaver::Job
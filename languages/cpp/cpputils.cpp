@@ -21,6 +21,7 @@
 #include "setuphelpers.h"
 #include "parser/rpp/preprocessor.h"
 #include "includepathcomputer.h"
+#include "includedirectoryindex.h"
 #include "debug.h"
 
 #include <interfaces/icore.h>
@@ -37,11 +38,13 @@
 
 #include <project/projectmodel.h>
 
-#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutex>
 #include <QThread>
 #include <QCoreApplication>
 
 Q_LOGGING_CATEGORY(CPP, "kdevelop.languages.cpp")
+Q_LOGGING_CATEGORY(CPPCOMPLETIONTIMING, "kdevelop.languages.cpp.completion.timing", QtWarningMsg)
 
 template<class T>
 static QList<T> makeListUnique(const QList<T>& list)
@@ -197,17 +200,75 @@ const Cpp::ReferenceCountedMacroSet& standardMacros()
   return macros;
 }
 
-QPair<Path, Path> findInclude(const Path::List& includePaths, const Path& localPath,
-                              const QString& includeName, int includeType,
-                              const Path& skipPath, bool quiet){
+namespace {
+///Identifies one resolution of an include-file by findInclude
+struct IncludeLookup
+{
+  Path::List includePaths;
+  Path localPath;
+  QString includeName;
+  int includeType;
+  Path skipPath;
+
+  bool operator==(const IncludeLookup& rhs) const {
+    return includeType == rhs.includeType && includeName == rhs.includeName && localPath == rhs.localPath
+        && skipPath == rhs.skipPath && includePaths == rhs.includePaths;
+  }
+};
+
+uint qHash(const IncludeLookup& lookup)
+{
+  uint ret = qHash(lookup.includeName) * 13 + qHash(lookup.localPath) * 7 + qHash(lookup.skipPath) + lookup.includeType;
+  foreach (const Path& path, lookup.includePaths) {
+    ret = ret * 31 + qHash(path);
+  }
+  return ret;
+}
+
+///The watched directories a resolution depends on, and whether it could be cached at all
+struct IncludeDependencies
+{
+  IncludeDependencies() : reliable(true) {
+  }
+  bool reliable;
+  QVector<IncludeDirectoryIndex::DirectoryRevision> directories;
+};
+
+struct CachedInclude
+{
+  ///The directories the result was computed from, it stays valid as long as none of them changes
+  QVector<IncludeDirectoryIndex::DirectoryRevision> directories;
+  QPair<Path, Path> result;
+};
+
+///When this count is reached, the cache is cleared
+const int maxCachedIncludes = 100000;
+
+QHash<IncludeLookup, CachedInclude> includeCache;
+QMutex includeCacheMutex;
+
+///Adds the directory the result depends on to @p dependencies, or marks them unreliable if it is not watched
+bool includeFileExists(const Path& directory, const QString& includeName, IncludeDependencies* dependencies)
+{
+  IncludeDirectoryIndex::DirectoryRevision dependency;
+  const bool exists = IncludeDirectoryIndex::self()->fileExists(directory.toLocalFile(), includeName, &dependency);
+  if (dependency.first.isEmpty()) {
+    dependencies->reliable = false;
+  } else {
+    dependencies->directories << dependency;
+  }
+  return exists;
+}
+
+///Resolves the include, and collects the directories the result depends on in @p dependencies
+QPair<Path, Path> findIncludeInPaths(const Path::List& includePaths, const Path& localPath,
+                                     const QString& includeName, int includeType,
+                                     const Path& skipPath, IncludeDependencies* dependencies)
+{
     QPair<Path, Path> ret;
-#ifdef DEBUG
-    qCDebug(CPP) << "searching for include-file" << includeName;
-    if( !skipPath.isEmpty() )
-        qCDebug(CPP) << "skipping path" << skipPath;
-#endif
 
     if (includeName.startsWith('/')) {
+        dependencies->reliable = false;
         QFileInfo info(includeName);
         if (info.exists() && info.isReadable() && info.isFile()) {
             //qCDebug(CPP) << "found include file:" << info.absoluteFilePath();
@@ -218,11 +279,9 @@ QPair<Path, Path> findInclude(const Path::List& includePaths, const Path& localP
     }
 
     if (includeType == rpp::Preprocessor::IncludeLocal && localPath != skipPath) {
-        Path check(localPath, includeName);
-        QFileInfo info(check.toLocalFile());
-        if (info.exists() && info.isReadable() && info.isFile()) {
-            //qCDebug(CPP) << "found include file:" << info.absoluteFilePath();
-            ret.first = check;
+        if (includeFileExists(localPath, includeName, dependencies)) {
+            //qCDebug(CPP) << "found include file:" << check;
+            ret.first = Path(localPath, includeName);
             ret.second = localPath;
             return ret;
         }
@@ -240,12 +299,9 @@ restart:
             }
         }
 
-        Path check(path, includeName);
-        QFileInfo info(check.toLocalFile());
-
-        if (info.exists() && info.isReadable() && info.isFile()) {
-            //qCDebug(CPP) << "found include file:" << info.absoluteFilePath();
-            ret.first = check;
+        if (includeFileExists(path, includeName, dependencies)) {
+            //qCDebug(CPP) << "found include file:" << check;
+            ret.first = Path(path, includeName);
             ret.second = path;
             return ret;
         }
@@ -261,7 +317,60 @@ restart:
     if ( idx != -1 ) {
       // HACK: parse Qt4 includes and similar even without the full include paths from the project manager
       // there, a file in /usr/include/qt4/QtCore/ tries to include sibling files via QtCore/file
-      ret = findInclude(includePaths, localPath, includeName.mid(idx + 1), rpp::Preprocessor::IncludeLocal, skipPath, false);
+      const QString siblingName = includeName.mid(idx + 1);
+      ret = findIncludeInPaths(includePaths, localPath, siblingName, rpp::Preprocessor::IncludeLocal, skipPath, dependencies);
+      if (!ret.first.isValid() && artificialCodeRepresentationExists(IndexedString(siblingName))) {
+        dependencies->reliable = false;
+        ret.first = Path(CodeRepresentation::artificialPath(siblingName));
+      }
+    }
+
+    return ret;
+}
+}
+
+QPair<Path, Path> findInclude(const Path::List& includePaths, const Path& localPath,
+                              const QString& includeName, int includeType,
+                              const Path& skipPath, bool quiet){
+    QPair<Path, Path> ret;
+#ifdef DEBUG
+    qCDebug(CPP) << "searching for include-file" << includeName;
+    if( !skipPath.isEmpty() )
+        qCDebug(CPP) << "skipping path" << skipPath;
+#endif
+
+    IncludeLookup lookup;
+    lookup.includePaths = includePaths;
+    lookup.localPath = localPath;
+    lookup.includeName = includeName;
+    lookup.includeType = includeType;
+    lookup.skipPath = skipPath;
+
+    bool cached = false;
+    {
+        CachedInclude entry;
+        {
+            QMutexLocker lock(&includeCacheMutex);
+            entry = includeCache.value(lookup);
+        }
+        if (!entry.directories.isEmpty() && IncludeDirectoryIndex::self()->isCurrent(entry.directories)) {
+            ret = entry.result;
+            cached = true;
+        }
+    }
+
+    if (!cached) {
+        IncludeDependencies dependencies;
+        ret = findIncludeInPaths(includePaths, localPath, includeName, includeType, skipPath, &dependencies);
+        if (dependencies.reliable && !dependencies.directories.isEmpty()) {
+            QMutexLocker lock(&includeCacheMutex);
+            if (includeCache.size() >= maxCachedIncludes) {
+                includeCache.clear();
+            }
+            CachedInclude& entry = includeCache[lookup];
+            entry.directories = dependencies.directories;
+            entry.result = ret;
+        }
     }
 
     if( !ret.first.isValid())
@@ -379,24 +488,19 @@ QList<KDevelop::IncludeItem> allFilesInIncludePath(const QString& source, bool l
           searchPath += addPath;
         }
 
-        QDirIterator dirContent(searchPath);
-
-        while(dirContent.hasNext()) {
-             dirContent.next();
+        foreach(const IncludeDirectoryIndex::Entry& entry, IncludeDirectoryIndex::self()->entries(searchPath)) {
             KDevelop::IncludeItem item;
-            item.name = dirContent.fileName();
+            item.name = entry.name;
 
-            if(item.name.startsWith('.') || item.name.endsWith("~")) //This filters out ".", "..", and hidden files, and backups
+            if(item.name.startsWith('.') || item.name.endsWith("~")) //This filters out hidden files, and backups
               continue;
-            QString suffix = dirContent.fileInfo().suffix();
-            if(!dirContent.fileInfo().suffix().isEmpty() && !headerExtensions().contains(suffix) && (!allowSourceFiles || !sourceExtensions().contains(suffix)))
+            if(!entry.suffix.isEmpty() && !headerExtensions().contains(entry.suffix) && (!allowSourceFiles || !sourceExtensions().contains(entry.suffix)))
               continue;
 
-            QString fullPath = dirContent.fileInfo().canonicalFilePath();
-            if (hadIncludePaths.contains(fullPath)) {
+            if (hadIncludePaths.contains(entry.canonicalPath)) {
               continue;
             } else {
-              hadIncludePaths.insert(fullPath);
+              hadIncludePaths.insert(entry.canonicalPath);
             }
             if(prependAddedPathToName) {
               item.name = addPath + item.name;
@@ -405,7 +509,7 @@ QList<KDevelop::IncludeItem> allFilesInIncludePath(const QString& source, bool l
               item.basePath = QUrl::fromLocalFile(searchPath);
             }
 
-            item.isDirectory = dirContent.fileInfo().isDir();
+            item.isDirectory = entry.isDirectory;
             item.pathNumber = pathNumber;
 
             ret << item;
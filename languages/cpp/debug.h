@@ -3,5 +3,6 @@
 
 #include <QLoggingCategory>
 Q_DECLARE_LOGGING_CATEGORY(CPP)
+Q_DECLARE_LOGGING_CATEGORY(CPPCOMPLETIONTIMING)
 
 #endif
@@ -0,0 +1,326 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "includedirectoryindex.h"
+
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+
+namespace CppUtils
+{
+
+namespace
+{
+///Beyond this count, directories are still listed but neither watched nor kept, so we don't exhaust the file-system watches
+const int maxIndexedDirectories = 5000;
+
+bool entryNameLessThan(const IncludeDirectoryIndex::Entry& lhs, const IncludeDirectoryIndex::Entry& rhs)
+{
+  return lhs.name < rhs.name;
+}
+}
+
+IncludeDirectoryIndex* IncludeDirectoryIndex::self()
+{
+  static IncludeDirectoryIndex* index = new IncludeDirectoryIndex;
+  return index;
+}
+
+IncludeDirectoryIndex::IncludeDirectoryIndex()
+  : m_watcher(0)
+{
+  //The index may first be used from a background thread, but the file-system watcher needs an event-loop
+  if (QCoreApplication::instance()) {
+    moveToThread(QCoreApplication::instance()->thread());
+  }
+}
+
+QSharedPointer<IncludeDirectoryIndex::Directory> IncludeDirectoryIndex::listDirectory(const QString& path)
+{
+  QSharedPointer<Directory> ret(new Directory);
+  QDirIterator dirContent(path);
+  while (dirContent.hasNext()) {
+    dirContent.next();
+    Entry entry;
+    entry.name = dirContent.fileName();
+    if (entry.name == QLatin1String(".") || entry.name == QLatin1String("..")) {
+      continue;
+    }
+    const QFileInfo info = dirContent.fileInfo();
+    entry.suffix = info.suffix();
+    entry.canonicalPath = info.canonicalFilePath();
+    entry.isDirectory = info.isDir();
+    entry.isReadableFile = info.isFile() && info.isReadable();
+    ret->entries << entry;
+  }
+
+  std::sort(ret->entries.begin(), ret->entries.end(), entryNameLessThan);
+  for (int i = 0; i < ret->entries.size(); ++i) {
+    ret->entryForName.insert(ret->entries[i].name, i);
+  }
+  return ret;
+}
+
+bool IncludeDirectoryIndex::ensureWatched(const QString& path)
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    if (m_watchedDirectories.contains(path)) {
+      return true;
+    }
+    if (m_unwatchableDirectories.contains(path)) {
+      return false;
+    }
+    if (QThread::currentThread() != thread()) {
+      if (!m_pendingWatches.contains(path)) {
+        m_pendingWatches.insert(path);
+        QMetaObject::invokeMethod(this, "watch", Qt::QueuedConnection, Q_ARG(QString, path));
+      }
+      return false;
+    }
+  }
+
+  watch(path);
+  QMutexLocker lock(&m_mutex);
+  return m_watchedDirectories.contains(path);
+}
+
+IncludeDirectoryIndex::DirectoryPointer IncludeDirectoryIndex::directory(const QString& path, bool* indexed)
+{
+  const QString cleanPath = QDir::cleanPath(path);
+  if (indexed) {
+    *indexed = false;
+  }
+  {
+    QMutexLocker lock(&m_mutex);
+    DirectoryPointer ret = m_directories.value(cleanPath);
+    if (ret) {
+      if (indexed) {
+        *indexed = true;
+      }
+      return ret;
+    }
+  }
+
+  //A missing directory cannot be watched, but its creation is noticed through the parent
+  const bool exists = QFileInfo(cleanPath).isDir();
+  const QString watchedPath = exists ? cleanPath : QFileInfo(cleanPath).absolutePath();
+  bool watched = false;
+  if (exists || (watchedPath != cleanPath && QFileInfo(watchedPath).isDir())) {
+    QMutexLocker lock(&m_mutex);
+    const bool full = m_directories.size() >= maxIndexedDirectories;
+    lock.unlock();
+    watched = !full && ensureWatched(watchedPath);
+  }
+
+  //Taken after the watch was added and before listing, so a change in between is noticed below
+  const uint revision = m_revision.load();
+  const QSharedPointer<Directory> ret = exists ? listDirectory(cleanPath) : QSharedPointer<Directory>(new Directory);
+  if (!watched) {
+    return ret;
+  }
+
+  QMutexLocker lock(&m_mutex);
+  if (m_revision.load() != revision) {
+    //Something changed while listing, the listing may already be outdated
+    return ret;
+  }
+  m_directories.insert(cleanPath, ret);
+  if (watchedPath != cleanPath) {
+    m_missingDirectories.insert(watchedPath, cleanPath);
+  }
+  if (indexed) {
+    *indexed = true;
+  }
+  return ret;
+}
+
+QVector<IncludeDirectoryIndex::Entry> IncludeDirectoryIndex::entries(const QString& directory, const QString& namePrefix)
+{
+  const DirectoryPointer dir = this->directory(directory);
+  if (namePrefix.isEmpty()) {
+    return dir->entries;
+  }
+
+  Entry prefixEntry;
+  prefixEntry.name = namePrefix;
+  QVector<Entry> ret;
+  for (QVector<Entry>::const_iterator it = std::lower_bound(dir->entries.constBegin(), dir->entries.constEnd(), prefixEntry, entryNameLessThan);
+       it != dir->entries.constEnd() && it->name.startsWith(namePrefix); ++it)
+  {
+    ret << *it;
+  }
+  return ret;
+}
+
+bool IncludeDirectoryIndex::findEntry(const QString& directory, const QString& name, Entry* entry)
+{
+  const DirectoryPointer dir = this->directory(directory);
+  QHash<QString, int>::const_iterator it = dir->entryForName.constFind(name);
+  if (it == dir->entryForName.constEnd()) {
+    return false;
+  }
+  if (entry) {
+    *entry = dir->entries[*it];
+  }
+  return true;
+}
+
+bool IncludeDirectoryIndex::fileExists(const QString& directory, const QString& relativePath, DirectoryRevision* dependency)
+{
+  *dependency = DirectoryRevision();
+  const QStringList segments = relativePath.split('/', QString::SkipEmptyParts);
+  if (segments.isEmpty()) {
+    return false;
+  }
+  if (segments.contains(QStringLiteral(".")) || segments.contains(QStringLiteral(".."))) {
+    //The directory the result depends on is not obvious, so the file is checked without a dependency
+    const QFileInfo info(directory + '/' + relativePath);
+    return info.exists() && info.isReadable() && info.isFile();
+  }
+
+  //The deepest existing directory on the way to the file, a change within it is the first sign of a different result
+  QString deepest = QDir::cleanPath(directory);
+  for (int i = 0; i < segments.size() - 1; ++i) {
+    const QString next = deepest + '/' + segments[i];
+    if (!QFileInfo(next).isDir()) {
+      break;
+    }
+    deepest = next;
+  }
+  if (!QFileInfo(deepest).isDir()) {
+    return false;
+  }
+
+  const bool watched = ensureWatched(deepest);
+  uint revision = 0;
+  if (watched) {
+    QMutexLocker lock(&m_mutex);
+    revision = m_directoryRevisions.value(deepest);
+  }
+
+  //Checked after the watch was added and the revision was taken, so a change in between is noticed
+  const QFileInfo info(QDir::cleanPath(directory) + '/' + segments.join(QStringLiteral("/")));
+  const bool exists = info.isFile() && info.isReadable();
+  if (watched) {
+    *dependency = qMakePair(deepest, revision);
+  }
+  return exists;
+}
+
+bool IncludeDirectoryIndex::isCurrent(const QVector<DirectoryRevision>& directories)
+{
+  QMutexLocker lock(&m_mutex);
+  foreach (const DirectoryRevision& directory, directories) {
+    if (m_directoryRevisions.value(directory.first) != directory.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void IncludeDirectoryIndex::prefetch(const QStringList& directories)
+{
+  QStringList missing;
+  {
+    QMutexLocker lock(&m_mutex);
+    foreach (const QString& directory, directories) {
+      if (!m_directories.contains(QDir::cleanPath(directory))) {
+        missing << directory;
+      }
+    }
+  }
+
+  if (missing.isEmpty()) {
+    return;
+  }
+  if (QThread::currentThread() == thread()) {
+    listInBackground(missing);
+  } else {
+    //Listings are only kept once the directories are watched, which happens on the owning thread
+    QMetaObject::invokeMethod(this, "listInBackground", Qt::QueuedConnection, Q_ARG(QStringList, missing));
+  }
+}
+
+void IncludeDirectoryIndex::listInBackground(const QStringList& directories)
+{
+  foreach (const QString& directory, directories) {
+    const QString cleanPath = QDir::cleanPath(directory);
+    ensureWatched(QFileInfo(cleanPath).isDir() ? cleanPath : QFileInfo(cleanPath).absolutePath());
+  }
+
+  QtConcurrent::run([this, directories]() {
+    foreach (const QString& directory, directories) {
+      this->directory(directory);
+    }
+  });
+}
+
+void IncludeDirectoryIndex::watch(const QString& directory)
+{
+  if (!m_watcher) {
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &IncludeDirectoryIndex::directoryChanged);
+  }
+  bool watched = m_watcher->directories().contains(directory);
+  if (!watched && m_watcher->directories().size() < maxIndexedDirectories) {
+    watched = m_watcher->addPath(directory);
+  }
+  if (!watched) {
+    //Without a watch we would never notice changes, so listings of it are never kept
+    qCDebug(CPP) << "cannot watch include directory" << directory;
+  }
+
+  QMutexLocker lock(&m_mutex);
+  m_pendingWatches.remove(directory);
+  if (watched) {
+    m_watchedDirectories.insert(directory);
+  } else {
+    m_unwatchableDirectories.insert(directory);
+  }
+}
+
+void IncludeDirectoryIndex::directoryChanged(const QString& directory)
+{
+  QMutexLocker lock(&m_mutex);
+  if (!m_watcher->directories().contains(directory)) {
+    //The watcher drops the watch of a removed directory
+    m_watchedDirectories.remove(directory);
+  }
+  dropDirectory(directory);
+}
+
+void IncludeDirectoryIndex::dropDirectory(const QString& path)
+{
+  ++m_directoryRevisions[path];
+  m_directories.remove(path);
+  foreach (const QString& missing, m_missingDirectories.values(path)) {
+    m_directories.remove(missing);
+  }
+  m_missingDirectories.remove(path);
+  m_revision.ref();
+}
+
+}
@@ -0,0 +1,134 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef INCLUDEDIRECTORYINDEX_H
+#define INCLUDEDIRECTORYINDEX_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+class QFileSystemWatcher;
+
+namespace CppUtils
+{
+
+/**
+ * In-memory index of the contents of include directories.
+ *
+ * Each directory is read from disk only once, and then served from memory. Indexed directories are
+ * watched, and their listing is dropped as soon as they change on disk, so the next query reads them again.
+ * A listing is only kept once the watch of its directory was added, so no change can be missed in between.
+ *
+ * All functions are thread-safe.
+ * */
+class IncludeDirectoryIndex : public QObject
+{
+  Q_OBJECT
+public:
+  struct Entry
+  {
+    QString name;
+    QString suffix;
+    ///Canonical path of the entry, can be used to filter out entries reached through different paths
+    QString canonicalPath;
+    bool isDirectory;
+    bool isReadableFile;
+  };
+
+  static IncludeDirectoryIndex* self();
+
+  ///Returns the entries of the given directory, sorted by name. If @p namePrefix is given, only entries starting with it are returned.
+  QVector<Entry> entries(const QString& directory, const QString& namePrefix = QString());
+
+  ///Returns whether the given directory contains an entry called @p name. If it does, it is stored in @p entry.
+  bool findEntry(const QString& directory, const QString& name, Entry* entry = 0);
+
+  ///A directory a result was computed from, and its revision at that time
+  typedef QPair<QString, uint> DirectoryRevision;
+
+  /**
+   * Returns whether @p relativePath, relative to @p directory, names an existing readable file.
+   * The file-system is checked directly, nothing is listed. The one directory whose change would alter the
+   * result, the parent of the file or its deepest existing ancestor, is watched and stored in @p dependency.
+   * If it is not watched yet, or @p relativePath contains "." or ".." segments, @p dependency is cleared
+   * and the result must not be cached.
+   * */
+  bool fileExists(const QString& directory, const QString& relativePath, DirectoryRevision* dependency);
+
+  ///Returns whether none of the given directories changed since their revisions were taken
+  bool isCurrent(const QVector<DirectoryRevision>& directories);
+
+  ///Reads the given directories into the index from a background thread, if they are not indexed yet.
+  void prefetch(const QStringList& directories);
+
+private slots:
+  ///Must be called from the thread owning the index
+  void watch(const QString& directory);
+  void directoryChanged(const QString& directory);
+  ///Watches the given directories, and then reads them into the index from a background thread
+  void listInBackground(const QStringList& directories);
+
+private:
+  IncludeDirectoryIndex();
+
+  struct Directory
+  {
+    QVector<Entry> entries;
+    QHash<QString, int> entryForName;
+  };
+  typedef QSharedPointer<const Directory> DirectoryPointer;
+
+  static QSharedPointer<Directory> listDirectory(const QString& path);
+  /**
+   * Returns the listing of the given directory, from the index if possible.
+   * @p indexed is set to whether the listing is kept in the index, so that later changes to it are noticed.
+   * */
+  DirectoryPointer directory(const QString& path, bool* indexed = 0);
+  /**
+   * Returns whether changes to the given directory are noticed. A listing must only be kept once this is true,
+   * else a change between the listing and the watch would be missed.
+   * From other threads the watch is queued, and this returns false until it was added.
+   * */
+  bool ensureWatched(const QString& path);
+  ///Must be called with m_mutex locked
+  void dropDirectory(const QString& path);
+
+  QMutex m_mutex;
+  QHash<QString, DirectoryPointer> m_directories;
+  ///Indexed directories that do not exist, hashed by their watched parent directory
+  QMultiHash<QString, QString> m_missingDirectories;
+  ///Increased whenever the directory changes, only present for directories that changed at least once
+  QHash<QString, uint> m_directoryRevisions;
+  ///Directories the watcher has confirmed, those with a queued watch, and those that cannot be watched
+  QSet<QString> m_watchedDirectories;
+  QSet<QString> m_pendingWatches;
+  QSet<QString> m_unwatchableDirectories;
+  ///Increased whenever any watched directory changes
+  QAtomicInt m_revision;
+  ///Only accessed from the foreground thread
+  QFileSystemWatcher* m_watcher;
+};
+
+}
+
+#endif // INCLUDEDIRECTORYINDEX_H
@@ -28,7 +28,65 @@
 #include <interfaces/icompletionsettings.h>
 #include "control.h"
 
+#include <algorithm>
+
+namespace {
+
+///Same as QChar::isSpace() on the latin-1 character, like KDevelop::strip() checks it
+inline bool isStripSpace(uint index) {
+  return isCharacter(index) && QChar(static_cast<uchar>(characterFromIndex(index))).isSpace();
+}
+
+///Same as isSpace() on QByteArray::trimmed()
+inline bool isTrimSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+///Same as KDevelop::strip(), on the range [@p start, @p end) of content-indices. Returns the new start.
+const uint* stripLeft(const char* str, const uint* start, const uint* end) {
+  const uint* ret = start;
+  for(const uint* cursor = start; cursor < end && *str; ++cursor) {
+    if(isStripSpace(*cursor))
+      continue;
+    //Identifiers never start with one of the stripped characters, so they end the match
+    if(!isCharacter(*cursor) || characterFromIndex(*cursor) != *str)
+      break;
+    ++str;
+    ret = cursor + 1;
+  }
+  return ret;
+}
+
+///Same as KDevelop::rStrip(), on the range [@p start, @p end) of content-indices. Returns the new end.
+const uint* stripRight(const char* str, const uint* start, const uint* end) {
+  const uint* ret = end;
+  for(const uint* cursor = end; cursor > start && *str; ) {
+    --cursor;
+    if(isStripSpace(*cursor))
+      continue;
+    if(!isCharacter(*cursor) || characterFromIndex(*cursor) != *str)
+      break;
+    ++str;
+    ret = cursor;
+  }
+  return ret;
+}
+
+void appendContents(const uint* start, const uint* end, QByteArray& target) {
+  for(const uint* cursor = start; cursor < end; ++cursor) {
+    if(isCharacter(*cursor)) {
+      target.append(characterFromIndex(*cursor));
+    }else{
+      const KDevelop::IndexedString str = KDevelop::IndexedString::fromIndex(*cursor);
+      target.append(str.c_str(), str.length());
+    }
+  }
+}
+
+}
+
 CommentFormatter::CommentFormatter()
+  : m_hasCharacterMarker(false)
 {
   if(!KDevelop::ICore::self())
     return; // May happen in tests i guess
@@ -37,19 +95,29 @@ CommentFormatter::CommentFormatter()
   {
     m_commentMarkers << marker.toUtf8();
     m_commentMarkerIndices << KDevelop::IndexedString(marker).index();
+    if(isCharacter(m_commentMarkerIndices.last()))
+      m_hasCharacterMarker = true;
   }
+  std::sort(m_commentMarkerIndices.begin(), m_commentMarkerIndices.end());
 }
 
 bool CommentFormatter::containsToDo(const uint* start, const uint* end) const
 {
-  const uint* markersStart = m_commentMarkerIndices.data();
-  const uint* markersEnd = m_commentMarkerIndices.data() + m_commentMarkerIndices.size();
-  
-  for(const uint* cursor = start; cursor < end; ++cursor)
-    for(const uint* marker = markersStart; marker < markersEnd; ++marker)
-      if(*cursor == *marker)
-        return true;
-  
+  if(m_commentMarkerIndices.isEmpty())
+    return false;
+
+  const uint* markersStart = m_commentMarkerIndices.constData();
+  const uint* markersEnd = markersStart + m_commentMarkerIndices.size();
+
+  //The markers are interned words, so a marker can only match one whole content-index. Most of the
+  //indices in a comment are single characters, which can be skipped without a lookup.
+  for(const uint* cursor = start; cursor < end; ++cursor) {
+    if(!m_hasCharacterMarker && isCharacter(*cursor))
+      continue;
+    if(std::binary_search(markersStart, markersEnd, *cursor))
+      return true;
+  }
+
   return false;
 }
 
@@ -123,27 +191,70 @@ void CommentFormatter::extractToDos( uint token, const ParseSession* session, Co
   }
 }
 
+void CommentFormatter::appendFormattedComment(const uint* start, const uint* end, QByteArray& target) const {
+  //Produces the same as KDevelop::formatComment(), without converting the comment and each of its lines to a QByteArray first
+  const int targetStart = target.size();
+  target.reserve(targetStart + (end - start));
+
+  while(start < end) {
+    const uint* lineEnd = start;
+    while(lineEnd < end && *lineEnd != indexFromCharacter('\n'))
+      ++lineEnd;
+
+    const uint* lineStart = stripLeft("///", start, lineEnd);
+    lineStart = stripLeft("//", lineStart, lineEnd);
+    lineStart = stripLeft("**", lineStart, lineEnd);
+    const uint* lineStop = stripRight("/**", lineStart, lineEnd);
+
+    if(target.size() != targetStart)
+      target.append('\n');
+    appendContents(lineStart, lineStop, target);
+
+    start = lineEnd + 1;
+  }
+
+  //Trim the appended text
+  int first = targetStart;
+  while(first < target.size() && isTrimSpace(target[first]))
+    ++first;
+  int last = target.size();
+  while(last > first && isTrimSpace(target[last - 1]))
+    --last;
+  target.truncate(last);
+  target.remove(targetStart, first - targetStart);
+}
+
 QByteArray CommentFormatter::formatComment( uint token, const ParseSession* session ) {
+  QByteArray ret;
   if( !token )
-    return QByteArray();
-  ///@todo Work directly on lists of IndexedString tokens, rather than QBytearray (faster), and only convert to QByteArray in the end.
+    return ret;
   const Token& commentToken( (*session->token_stream)[token] );
-  return KDevelop::formatComment( stringFromContents(session->contentsVector(), commentToken.position, commentToken.size ) );
+  const uint* start = session->contents() + commentToken.position;
+  appendFormattedComment(start, start + commentToken.size, ret);
+  return ret;
 }
 
 QByteArray CommentFormatter::formatComment( const ListNode<uint>* comments, const ParseSession* session ) {
   QByteArray ret;
-  ///@todo Work directly on lists of IndexedString tokens, rather than QBytearray (faster), and only convert to QByteArray in the end.
   if( comments )
   {
     const ListNode<uint> *it = comments->toFront(), *end = it;
     do {
-      QByteArray c = CommentFormatter::formatComment(it->element, session);
+      if( it->element ) {
+        const Token& commentToken( (*session->token_stream)[it->element] );
+        const uint* start = session->contents() + commentToken.position;
 
-      if( ret.isEmpty() )
-        ret = c;
-      else
-        ret += "\n(" + c + ")";
+        //The first comment is used as is, the following ones are appended in parens
+        if( ret.isEmpty() ) {
+          appendFormattedComment(start, start + commentToken.size, ret);
+        }else{
+          ret += "\n(";
+          appendFormattedComment(start, start + commentToken.size, ret);
+          ret += ')';
+        }
+      }else if( !ret.isEmpty() ) {
+        ret += "\n()";
+      }
 
       it = it->next;
     }while( it != end );
@@ -151,4 +262,3 @@ QByteArray CommentFormatter::formatComment( const ListNode<uint>* comments, cons
 
   return ret;
 }
-
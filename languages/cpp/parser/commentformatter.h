@@ -46,9 +46,12 @@ class KDEVCPPPARSER_EXPORT CommentFormatter {
     ///Processes the list of comments represented by the given token-number within the parse-session's token-stream
     QByteArray formatComment( const ListNode<uint>* node, const ParseSession* session );
   private:
+    ///Formats the comment directly from the token contents, and appends the result to @p target
+    void appendFormattedComment(const uint* start, const uint* end, QByteArray& target) const;
     bool containsToDo(const uint* start, const uint* end) const;
     bool containsToDo(const QByteArray& text) const;
-    QVector<uint> m_commentMarkerIndices; // IndexedString indices
+    QVector<uint> m_commentMarkerIndices; // IndexedString indices, sorted
+    bool m_hasCharacterMarker; // Whether one of the markers is a single character
     QVector<QByteArray> m_commentMarkers;
 };
 
@@ -32,6 +32,24 @@
 #include "parentvisitor.h"
 #include "debug.h"
 
+#include <QThreadStorage>
+
+namespace {
+///The location-table copy of a thread, see ParseSession::ThreadLocalPositions
+struct ThreadLocationTable
+{
+  ThreadLocationTable() : session(0), table(0) {
+  }
+  ~ThreadLocationTable() {
+    delete table;
+  }
+  const ParseSession* session;
+  rpp::LocationTable* table;
+};
+
+QThreadStorage<ThreadLocationTable*> threadLocationTables;
+}
+
 ParseSession::ParseSession()
   : mempool(new MemoryPool)
   , token_stream(0)
@@ -138,18 +156,48 @@ KDevelop::DeclarationPointer ParseSession::declarationFromAstNode(AST * node)
     return m_AstToDuchain[node];
 }
 
+const rpp::LocationTable* ParseSession::locationTable() const
+{
+  if(threadLocationTables.hasLocalData()) {
+    const ThreadLocationTable* local = threadLocationTables.localData();
+    if(local->session == this)
+      return local->table;
+  }
+  return m_locationTable;
+}
+
 rpp::Anchor ParseSession::positionAt(std::size_t offset, bool collapseIfMacroExpansion) const
 {
   Q_ASSERT(m_locationTable);
 
-  return m_locationTable->positionAt(offset, m_contents, collapseIfMacroExpansion).first;
+  return locationTable()->positionAt(offset, m_contents, collapseIfMacroExpansion).first;
 }
 
 QPair<rpp::Anchor, uint> ParseSession::positionAndSpaceAt(std::size_t offset, bool collapseIfMacroExpansion) const
 {
   Q_ASSERT(m_locationTable);
 
-  return m_locationTable->positionAt(offset, m_contents, collapseIfMacroExpansion);
+  return locationTable()->positionAt(offset, m_contents, collapseIfMacroExpansion);
+}
+
+ParseSession::ThreadLocalPositions::ThreadLocalPositions(const ParseSession* session)
+{
+  Q_ASSERT(session->m_locationTable);
+
+  if(!threadLocationTables.hasLocalData())
+    threadLocationTables.setLocalData(new ThreadLocationTable);
+  ThreadLocationTable* local = threadLocationTables.localData();
+  Q_ASSERT(!local->session);
+  local->session = session;
+  local->table = new rpp::LocationTable(*session->m_locationTable);
+}
+
+ParseSession::ThreadLocalPositions::~ThreadLocalPositions()
+{
+  ThreadLocationTable* local = threadLocationTables.localData();
+  delete local->table;
+  local->table = 0;
+  local->session = 0;
 }
 
 std::size_t ParseSession::size() const
@@ -111,6 +111,21 @@ public:
 
   QPair<rpp::Anchor, uint> positionAndSpaceAt(std::size_t offset, bool collapseIfMacroExpansion = false) const;
 
+  /**
+   * The location-table caches the last resolved position, so it must not be used by multiple threads at once.
+   * While an instance exists, the positions the creating thread requests from @p session are resolved through
+   * a private copy of the location-table. Instances for the same session must not be nested.
+   */
+  class KDEVCPPPARSER_EXPORT ThreadLocalPositions
+  {
+  public:
+    explicit ThreadLocalPositions(const ParseSession* session);
+    ~ThreadLocalPositions();
+
+  private:
+    Q_DISABLE_COPY(ThreadLocalPositions)
+  };
+
   ///The contents must already be tokenized. Either by the preprocessor, or by tokenizeFromByteArray(..)
   void setContents(const PreprocessedContents& contents, rpp::LocationTable* locationTable);
 
@@ -145,6 +160,9 @@ public:
   void dumpNode(AST* node) const;
 
 private:
+  ///The location-table to resolve positions with in the current thread
+  const rpp::LocationTable* locationTable() const;
+
   PreprocessedContents m_contents;
   rpp::LocationTable* m_locationTable;
   TranslationUnitAST * m_topAstNode;
@@ -18,11 +18,69 @@
 
 #include "macrorepository.h"
 
+#include <QMutexLocker>
+
 //The text is supposed to be utf8 encoded
 using namespace rpp;
 
+DEFINE_LIST_MEMBER_HASH(MacroBodyItem, body, KDevelop::IndexedString)
+
+MacroBodyRepository& macroBodyRepository()
+{
+  static MacroBodyRepository repo("macro body repository");
+  return repo;
+}
+
+namespace {
+
+///Returns the body with the given tokens, and references it. The macro repository must be locked.
+uint referenceBody(const KDevelop::IndexedString* tokens, uint size)
+{
+  MacroBodyItem item;
+  for(uint a = 0; a < size; ++a)
+    item.bodyList().append(tokens[a]);
+
+  QMutexLocker lock(macroBodyRepository().mutex());
+  const uint index = macroBodyRepository().index(MacroBodyRequest(item));
+  KDevelop::DynamicItem<MacroBodyItem, true> gotItem = macroBodyRepository().dynamicItemFromIndex(index);
+  ++gotItem->m_refCount;
+  return index;
+}
+
+///Releases a reference to the body, and deletes it if it was the last one. The macro repository must be locked.
+void releaseBody(uint index)
+{
+  QMutexLocker lock(macroBodyRepository().mutex());
+  KDevelop::DynamicItem<MacroBodyItem, true> item = macroBodyRepository().dynamicItemFromIndex(index);
+  --item->m_refCount;
+  if(!item->m_refCount)
+    macroBodyRepository().deleteItem(index);
+}
+
+struct MacroBodyStatisticsVisitor {
+  MacroBodyStatistics statistics;
+
+  bool operator()(const MacroBodyItem* item) {
+    ++statistics.bodies;
+    statistics.references += item->m_refCount;
+    statistics.storedTokens += item->bodySize();
+    statistics.referencedTokens += item->bodySize() * item->m_refCount;
+    return true;
+  }
+};
+
+}
+
+MacroBodyStatistics macroBodyStatistics()
+{
+  MacroBodyStatisticsVisitor visitor;
+  macroBodyRepository().visitAllItems(visitor);
+  return visitor.statistics;
+}
+
 size_t MacroRepositoryItemRequest::itemSize() const {
-  return macro.dynamicSize();
+  //The definition is stored in the macro-body repository
+  return macro.dynamicSize() - macro.inlineDefinitionSize() * sizeof(KDevelop::IndexedString);
 }
 
 MacroRepositoryItemRequest::MacroRepositoryItemRequest(const rpp::pp_macro& _macro) : macro(_macro) {
@@ -30,11 +88,20 @@ MacroRepositoryItemRequest::MacroRepositoryItemRequest(const rpp::pp_macro& _mac
 }
 
 void MacroRepositoryItemRequest::destroy(rpp::pp_macro* item, KDevelop::AbstractItemRepository&) {
+  if(item->m_definitionBody)
+    releaseBody(item->m_definitionBody);
   item->~pp_macro();
 }
 
 void MacroRepositoryItemRequest::createItem(rpp::pp_macro* item) const {
-  new (item) pp_macro(macro, false);
+  if(!macro.definitionSize()) {
+    new (item) pp_macro(macro, false);
+  }else{
+    pp_macro withoutDefinition(macro);
+    withoutDefinition.inlineDefinitionList().clear();
+    withoutDefinition.m_definitionBody = referenceBody(macro.definition(), macro.definitionSize());
+    new (item) pp_macro(withoutDefinition, false);
+  }
   Q_ASSERT(*item == macro);
 }
 
@@ -20,9 +20,89 @@
 #define MACROREPOSITORY_H
 
 #include <serialization/itemrepository.h>
+#include <language/duchain/appendedlist.h>
 #include "cpprppexport.h"
 #include "pp-macro.h"
 
+KDEVCPPRPP_EXPORT DECLARE_LIST_MEMBER_HASH(MacroBodyItem, body, KDevelop::IndexedString)
+
+/**
+ * The definition of a repository-macro.
+ *
+ * Many macro versions differ only in their file, line or flags, for example when the same headers are
+ * parsed with different defines, so the definitions are stored once and shared by all macros using them.
+ * */
+class KDEVCPPRPP_EXPORT MacroBodyItem {
+  public:
+    MacroBodyItem() {
+      initializeAppendedLists(true);
+      m_refCount = 0;
+    }
+    MacroBodyItem(const MacroBodyItem& rhs, bool dynamic) {
+      initializeAppendedLists(dynamic);
+      m_refCount = rhs.m_refCount;
+      copyListsFrom(rhs);
+    }
+    ~MacroBodyItem() {
+      freeAppendedLists();
+    }
+
+    bool persistent() const {
+      return (bool)m_refCount;
+    }
+
+    bool operator==(const MacroBodyItem& rhs) const {
+      return listsEqual(rhs);
+    }
+
+    uint hash() const {
+      uint ret = 0;
+      for(uint a = 0; a < bodySize(); ++a)
+        ret = body()[a].hash() + 17 * ret;
+      return ret;
+    }
+
+    uint itemSize() const {
+      return dynamicSize();
+    }
+
+    uint classSize() const {
+      return sizeof(*this);
+    }
+
+    ///Count of repository-macros using this body
+    uint m_refCount;
+    START_APPENDED_LISTS(MacroBodyItem);
+    APPENDED_LIST_FIRST(MacroBodyItem, KDevelop::IndexedString, body);
+    END_APPENDED_LISTS(MacroBodyItem, body);
+  private:
+    MacroBodyItem& operator=(const MacroBodyItem&);
+};
+
+typedef KDevelop::AppendedListItemRequest<MacroBodyItem, 40*4> MacroBodyRequest;
+typedef KDevelop::ItemRepository<MacroBodyItem, MacroBodyRequest> MacroBodyRepository;
+
+KDEVCPPRPP_EXPORT MacroBodyRepository& macroBodyRepository();
+
+struct MacroBodyStatistics {
+  ///Count of distinct stored bodies
+  uint bodies = 0;
+  ///Count of repository-macros referencing a body
+  uint references = 0;
+  ///Tokens actually stored
+  uint storedTokens = 0;
+  ///Tokens that would be stored if each macro had its own copy
+  uint referencedTokens = 0;
+
+  ///How many times less tokens are stored than without sharing
+  double deduplicationRatio() const {
+    return storedTokens ? double(referencedTokens) / storedTokens : 1.0;
+  }
+};
+
+///Collects the statistics of the macro-body repository, to see how much sharing the bodies saves
+KDEVCPPRPP_EXPORT MacroBodyStatistics macroBodyStatistics();
+
 struct KDEVCPPRPP_EXPORT MacroRepositoryItemRequest {
 
   //The text is supposed to be utf8 encoded
@@ -42,6 +122,7 @@ struct KDEVCPPRPP_EXPORT MacroRepositoryItemRequest {
   
   void createItem(rpp::pp_macro* item) const;
   
+  ///Also releases the shared definition of the macro
   static void destroy(rpp::pp_macro* item, KDevelop::AbstractItemRepository&);
   
   static bool persistent(const rpp::pp_macro* /*item*/) {
@@ -52,6 +52,7 @@ pp::pp(Preprocessor* preprocessor)
   , hideNext(false)
   , hadGuardCandidate(false)
   , checkGuardEnd(false)
+  , m_scanning(false)
 {
   iflevel = 0;
   _M_skipping[iflevel] = 0;
@@ -91,9 +92,14 @@ PreprocessedContents pp::processFile(const QString& fileName, const QByteArray&
 void pp::processFileInternal(const QString& fileName, const QByteArray& fileContents, PreprocessedContents& result)
 {
     m_files.push(KDevelop::IndexedString(fileName));
+    PreprocessedContents contents = tokenizeFromByteArray(fileContents);
+    if(m_scanning) {
+      Stream is(&contents);
+      operator () (is, devnull());
+      return;
+    }
     // Guestimate as to how much expansion will occur
     result.reserve(int(fileContents.length() * 1.2));
-    PreprocessedContents contents = tokenizeFromByteArray(fileContents);
     {
       Stream is(&contents);
       Stream rs(&result, m_environment->locationTable());
@@ -134,8 +140,9 @@ void pp::handle_directive(uint directive, Stream& input, Stream& output)
       if (! skipping ())
         return handle_define(input);
 
+  //In scanning mode the includes of all branches are reported, since the macros that decide them are usually unknown
   if(directive == includeDirective || directive == includeNextDirective)
-      if (! skipping ())
+      if (! skipping () || m_scanning)
         return handle_include (directive == includeNextDirective, input, output);
 
   if(directive == undefDirective)
@@ -280,6 +287,14 @@ void pp::operator () (Stream& input, Stream& output)
     } else if (skipping ()) {
       skip (input, devnull());
 
+    } else if (m_scanning) {
+      //Without expansion we cannot tell comments from content, so any text behind the guard's #endif counts
+      if(checkGuardEnd) {
+        guardCandidate = KDevelop::IndexedString();
+        checkGuardEnd = false;
+      }
+      skip (input, devnull());
+
     } else {
       output.mark(input.inputPosition());
       if(checkGuardEnd) {
@@ -383,7 +398,7 @@ void pp::handle_define (Stream& input)
       if (!input.atEnd() && input == '\n')
       {
         skip_blanks(++input, devnull());
-        macro.definitionList().append(KDevelop::IndexedString::fromIndex(indexFromCharacter(' ')));
+        macro.inlineDefinitionList().append(KDevelop::IndexedString::fromIndex(indexFromCharacter(' ')));
         continue;
 
       } else {
@@ -396,24 +411,24 @@ void pp::handle_define (Stream& input)
       do {
         if (input == '\\' && input.peekNextCharacter() == '"') {
           // skip escaped close quote
-          macro.definitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
+          macro.inlineDefinitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
           ++input;
           if(input.atEnd())
             break;
         }
-        macro.definitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
+        macro.inlineDefinitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
         ++input;
       } while (!input.atEnd() && input != '"' && input != '\n');
 
       if(!input.atEnd())
       {
-        macro.definitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
+        macro.inlineDefinitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
         ++input;
       }
       continue;
     }
 
-    macro.definitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
+    macro.inlineDefinitionList().append(KDevelop::IndexedString::fromIndex(input.current()));
     ++input;
   }
 
@@ -1262,6 +1277,16 @@ void pp::setHideNextMacro( bool h )
   hideNext = h;
 }
 
+bool pp::isScanning() const
+{
+  return m_scanning;
+}
+
+void pp::setScanning(bool scanning)
+{
+  m_scanning = scanning;
+}
+
 Environment* pp::environment( ) const
 {
   return m_environment;
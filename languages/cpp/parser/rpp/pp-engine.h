@@ -138,6 +138,7 @@ class KDEVCPPRPP_EXPORT pp
   bool haveNextToken;
   bool hideNext;
   bool hadGuardCandidate, checkGuardEnd;
+  bool m_scanning;
   KDevelop::IndexedString guardCandidate;
 
   union {
@@ -194,6 +195,17 @@ public:
   bool hideNextMacro() const;
   void setHideNextMacro(bool hideNext);
 
+  /**
+   * In scanning mode only the directives are processed: #define and #undef change the environment, and the #if
+   * structure decides which of them are active. Includes are reported to the Preprocessor from all branches,
+   * including inactive ones, since a file is usually scanned without the macros that decide its conditions.
+   * Ordinary text is skipped without expanding any macros, so processFile() returns empty contents and
+   * headerSectionEnded() is never called.
+   * This is much faster than full preprocessing when only the include-graph is needed.
+   */
+  void setScanning(bool scanning);
+  bool isScanning() const;
+
   Environment* environment() const;
   // once set, belongs to the engine
   void setEnvironment(Environment* env);
@@ -55,6 +55,13 @@ LocationTable::LocationTable(const PreprocessedContents& contents)
       anchor(i + 1, Anchor(++line, 0), 0);
 }
 
+LocationTable::LocationTable(const LocationTable& other)
+  : m_offsetTable(other.m_offsetTable)
+  , m_positionAtLastOffset(EMPTY_CACHE)
+{
+  m_currentOffset = m_offsetTable.constEnd();
+}
+
 QPair<rpp::Anchor, uint> LocationTable::positionAt(std::size_t offset, const PreprocessedContents& contents, bool collapseIfMacroExpansion) const
 {
   AnchorInTable ret = anchorForOffset(offset, collapseIfMacroExpansion);
@@ -39,6 +39,9 @@ class KDEVCPPRPP_EXPORT LocationTable
     /// Generates the location table from the contents
     LocationTable(const PreprocessedContents& contents);
 
+    /// Shares the anchors of @p other, but not its position caches, so the copy can be used by another thread
+    LocationTable(const LocationTable& other);
+
     ///@param contents is allowed to be zero only if offset is zero, or if anchor.column is zero.
     void anchor(std::size_t offset, Anchor anchor, const PreprocessedContents* contents);
 
@@ -25,11 +25,13 @@
 #include "macrorepository.h"
 #include <util/kdevvarlengtharray.h>
 
+#include <algorithm>
+
 using namespace rpp;
 
 namespace rpp {
 using namespace KDevelop;
-DEFINE_LIST_MEMBER_HASH(pp_macro, definition, KDevelop::IndexedString)
+DEFINE_LIST_MEMBER_HASH(pp_macro, inlineDefinition, KDevelop::IndexedString)
 DEFINE_LIST_MEMBER_HASH(pp_macro, formals, KDevelop::IndexedString)
 }
 
@@ -50,7 +52,41 @@ bool pp_macro::operator==(const pp_macro& rhs) const {
          variadics == rhs.variadics &&
          fixed == rhs.fixed &&
          defineOnOverride == rhs.defineOnOverride &&
-         listsEqual(rhs);
+         definitionsEqual(rhs) &&
+         formalsSize() == rhs.formalsSize() &&
+         std::equal(formals(), formals() + formalsSize(), rhs.formals());
+}
+
+bool pp_macro::definitionsEqual(const pp_macro& rhs) const
+{
+  //Repository-macros with the same body share it
+  if(m_definitionBody && m_definitionBody == rhs.m_definitionBody)
+    return true;
+  const uint size = definitionSize();
+  return size == rhs.definitionSize() && std::equal(definition(), definition() + size, rhs.definition());
+}
+
+const IndexedString* pp_macro::definition() const
+{
+  if(m_definitionBody)
+    return macroBodyRepository().itemFromIndex(m_definitionBody)->body();
+  return inlineDefinition();
+}
+
+uint pp_macro::definitionSize() const
+{
+  if(m_definitionBody)
+    return macroBodyRepository().itemFromIndex(m_definitionBody)->bodySize();
+  return inlineDefinitionSize();
+}
+
+void pp_macro::copyDefinitionFrom(const pp_macro& rhs)
+{
+  //Dynamic macros keep their own copy of a shared definition, so they do not depend on the lifetime of the repository-macro
+  const IndexedString* body = rhs.definition();
+  const uint size = rhs.definitionSize();
+  for(uint a = 0; a < size; ++a)
+    inlineDefinitionList().append(body[a]);
 }
 
 bool pp_macro::operator!=(const pp_macro& rhs) const
@@ -77,6 +113,7 @@ pp_macro::pp_macro(const KDevelop::IndexedString& nm) : name(nm)
   , defineOnOverride(false)
   , m_valueHashValid(false)
   , m_valueHash(0)
+  , m_definitionBody(0)
 {
   initializeAppendedLists();
 }
@@ -92,10 +129,13 @@ pp_macro::pp_macro(const pp_macro& rhs, bool dynamic) :
    fixed(rhs.fixed),
    defineOnOverride(rhs.defineOnOverride),
    m_valueHashValid(true),
-   m_valueHash(rhs.valueHash())
+   m_valueHash(rhs.valueHash()),
+   m_definitionBody(dynamic ? 0 : rhs.m_definitionBody)
 {
   initializeAppendedLists(dynamic);
   copyListsFrom(rhs);
+  if(dynamic && rhs.m_definitionBody)
+    copyDefinitionFrom(rhs);
 }
 
 pp_macro& pp_macro::operator=(const pp_macro& rhs)
@@ -111,8 +151,11 @@ pp_macro& pp_macro::operator=(const pp_macro& rhs)
   defineOnOverride = rhs.defineOnOverride;
   m_valueHashValid = true;
   m_valueHash = rhs.valueHash();
+  m_definitionBody = 0;
 
   copyListsFrom(rhs);
+  if(rhs.m_definitionBody)
+    copyDefinitionFrom(rhs);
 
   return *this;
 }
@@ -148,9 +191,9 @@ void pp_macro::setDefinitionText(QString definition) {
 }
 
 void pp_macro::setDefinitionText(QByteArray definition) {
-  definitionList().clear();
+  inlineDefinitionList().clear();
   foreach(uint i, convertFromByteArray(definition))
-    definitionList().append(KDevelop::IndexedString::fromIndex(i));
+    inlineDefinitionList().append(KDevelop::IndexedString::fromIndex(i));
 }
 
 void pp_macro::computeHash() const {
@@ -34,7 +34,7 @@
 
 namespace rpp {
 
-KDEVCPPRPP_EXPORT DECLARE_LIST_MEMBER_HASH(pp_macro, definition, KDevelop::IndexedString)
+KDEVCPPRPP_EXPORT DECLARE_LIST_MEMBER_HASH(pp_macro, inlineDefinition, KDevelop::IndexedString)
 KDEVCPPRPP_EXPORT DECLARE_LIST_MEMBER_HASH(pp_macro, formals, KDevelop::IndexedString)
 
   //This contains the data of a macro that can be marshalled by directly copying the memory
@@ -78,6 +78,10 @@ public:
   
   //The valueHash is not necessarily valid
   mutable HashType m_valueHash; //Hash that represents the values of all macros
+
+  //Index of the definition in the macro-body repository, if this is a repository-macro with a non-empty definition.
+  //Repository-macros with equal definitions share the same body, see MacroRepositoryItemRequest.
+  uint m_definitionBody;
   
   bool operator==(const pp_macro& rhs) const;
   bool operator!=(const pp_macro& rhs) const;
@@ -165,9 +169,14 @@ public:
     setDefinitionText(QByteArray(definition));
   }
   
+  ///The tokens of the definition
+  const IndexedString* definition() const;
+  uint definitionSize() const;
+
+  //The definition of dynamic macros. It is empty for repository-macros, which use m_definitionBody instead.
   START_APPENDED_LISTS(pp_macro)
-  APPENDED_LIST_FIRST(pp_macro, IndexedString, definition)
-  APPENDED_LIST(pp_macro, IndexedString, formals, definition)
+  APPENDED_LIST_FIRST(pp_macro, IndexedString, inlineDefinition)
+  APPENDED_LIST(pp_macro, IndexedString, formals, inlineDefinition)
   END_APPENDED_LISTS(pp_macro, formals)
 
   ///Returns true if this macro is stored in a central repository, else false.
@@ -177,6 +186,9 @@ public:
 
 private:
     void computeHash() const;
+    bool definitionsEqual(const pp_macro& rhs) const;
+    ///Appends the definition of @p rhs to the inline definition
+    void copyDefinitionFrom(const pp_macro& rhs);
 };
 
 }
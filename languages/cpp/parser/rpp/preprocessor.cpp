@@ -63,3 +63,33 @@ void Preprocessor::headerSectionEnded(rpp::Stream& stream)
 void Preprocessor::foundHeaderGuard(rpp::Stream& /*stream*/, KDevelop::IndexedString /*guardName*/)
 {
 }
+
+QList<IncludeScanner::Include> IncludeScanner::scan(const QString& fileName)
+{
+  QFile file(fileName);
+  if(!file.open(QIODevice::ReadOnly))
+    return QList<Include>();
+
+  return scan(fileName, file.readAll());
+}
+
+QList<IncludeScanner::Include> IncludeScanner::scan(const QString& fileName, const QByteArray& contents)
+{
+  m_includes.clear();
+  pp proc(this);
+  proc.setScanning(true);
+  proc.processFile(fileName, contents);
+  return m_includes;
+}
+
+Stream* IncludeScanner::sourceNeeded(QString& fileName, IncludeType type, int sourceLine, bool skipCurrentPath)
+{
+  Q_UNUSED(skipCurrentPath)
+
+  Include include;
+  include.name = fileName;
+  include.type = type;
+  include.sourceLine = sourceLine;
+  m_includes << include;
+  return 0;
+}
@@ -22,6 +22,7 @@
 #ifndef PREPROCESSOR_H
 #define PREPROCESSOR_H
 
+#include <QtCore/QList>
 #include <QtCore/QString>
 #include "cpprppexport.h"
 
@@ -78,6 +79,32 @@ public:
     virtual void foundHeaderGuard(rpp::Stream& stream, KDevelop::IndexedString guardName);
 };
 
+/**
+ * Collects the include-directives of a single file, by running the preprocessor in scanning mode.
+ * Included files are not followed, so the macros that decide conditional includes are unknown, and the
+ * includes of all #if branches are collected. Includes in comments are not.
+ */
+class KDEVCPPRPP_EXPORT IncludeScanner : public Preprocessor
+{
+public:
+    struct Include {
+      QString name;
+      IncludeType type;
+      int sourceLine;
+    };
+
+    ///Reads and scans the file @p fileName. Returns an empty list if it cannot be read.
+    QList<Include> scan(const QString& fileName);
+
+    ///Scans @p contents as the contents of @p fileName
+    QList<Include> scan(const QString& fileName, const QByteArray& contents);
+
+    virtual Stream* sourceNeeded(QString& fileName, IncludeType type, int sourceLine, bool skipCurrentPath) override;
+
+private:
+    QList<Include> m_includes;
+};
+
 }
 
 #endif
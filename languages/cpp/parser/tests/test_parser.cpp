@@ -42,6 +42,8 @@
 #include <rpp/chartools.h>
 #include <rpp/pp-engine.h>
 
+#include <language/duchain/stringhelpers.h>
+
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
 
@@ -445,6 +447,32 @@ void TestParser::testComments7()
   QCOMPARE(QString::fromUtf8(CommentFormatter().formatComment(it->element->comments, lastSession)), QString("Foo bar"));
 }
 
+void TestParser::testComments8_data()
+{
+  QTest::addColumn<QByteArray>("comment");
+
+  QTest::newRow("line") << QByteArray("/// foo bar  ");
+  QTest::newRow("block") << QByteArray("/**\n * foo\n *\n * bar\n **/");
+  QTest::newRow("qt-style") << QByteArray("/*!\n    \\brief foo\n\n    bar * 2\n*/");
+  QTest::newRow("inline") << QByteArray("/* foo */");
+  QTest::newRow("stars") << QByteArray("/******\n ****** foo */");
+  QTest::newRow("empty") << QByteArray("/**/");
+  QTest::newRow("merged") << QByteArray("//foo\n  // bar\n  ///baz");
+}
+
+void TestParser::testComments8()
+{
+  //The comment formatter works on the token contents, it must give the same result as formatting the text
+  QFETCH(QByteArray, comment);
+  TranslationUnitAST* ast = parse("//TranslationUnitComment\n" + comment + "\nint i;\n");
+  const ListNode<DeclarationAST*>* it = ast->declarations;
+  QVERIFY(it);
+  it = it->next;
+  QVERIFY(it);
+  QVERIFY(it->element->comments);
+  QCOMPARE(CommentFormatter().formatComment(it->element->comments, lastSession), KDevelop::formatComment(comment));
+}
+
 void TestParser::testEscapedNewline_data()
 {
   QTest::addColumn<QByteArray>("module");
@@ -583,6 +611,63 @@ void TestParser::testEmptyInclude()
   QCOMPARE(pp.problems().first()->finalLocation().end(), KTextEditor::Cursor(0, 8));
 }
 
+void TestParser::testIncludeScanner()
+{
+  QByteArray code("#include <a.h>\n"
+                  "#define LOCAL \"b.h\"\n"
+                  "#include LOCAL\n"
+                  "#ifdef UNDEFINED\n"
+                  "#include \"c.h\"\n"
+                  "#else\n"
+                  "#include_next \"d.h\"\n"
+                  "#endif\n"
+                  "int main() { return 0; }\n"
+                  "/* #include \"e.h\" */\n");
+
+  rpp::IncludeScanner scanner;
+  QList<rpp::IncludeScanner::Include> includes = scanner.scan("/anonymous", code);
+  //The includes of inactive branches are collected too, only the commented-out one is not
+  QCOMPARE(includes.size(), 4);
+  QCOMPARE(includes[0].name, QString("a.h"));
+  QCOMPARE(includes[0].type, rpp::Preprocessor::IncludeGlobal);
+  QCOMPARE(includes[1].name, QString("b.h"));
+  QCOMPARE(includes[1].type, rpp::Preprocessor::IncludeLocal);
+  QCOMPARE(includes[2].name, QString("c.h"));
+  QCOMPARE(includes[2].sourceLine, 4);
+  QCOMPARE(includes[3].name, QString("d.h"));
+  QCOMPARE(includes[3].sourceLine, 6);
+
+  //Nothing is expanded in scanning mode
+  rpp::Preprocessor preprocessor;
+  rpp::pp pp(&preprocessor);
+  pp.setScanning(true);
+  QVERIFY(pp.processFile("/anonymous", code).isEmpty());
+}
+
+void TestParser::benchmarkPreprocessor_data()
+{
+  QTest::addColumn<bool>("scanning");
+
+  QTest::newRow("full") << false;
+  QTest::newRow("scanning") << true;
+}
+
+void TestParser::benchmarkPreprocessor()
+{
+  QFETCH(bool, scanning);
+
+  QFile file(TEST_FILE);
+  QVERIFY(file.open(QFile::ReadOnly));
+  const QByteArray contents = file.readAll();
+
+  QBENCHMARK {
+    rpp::Preprocessor preprocessor;
+    rpp::pp pp(&preprocessor);
+    pp.setScanning(scanning);
+    pp.processFile("/anonymous", contents);
+  }
+}
+
 void TestParser::testCondition()
 {
   QByteArray method("bool i = (small < big || big > small);");
@@ -56,6 +56,8 @@ private slots:
   void testComments5();
   void testComments6();
   void testComments7();
+  void testComments8_data();
+  void testComments8();
 
   void testEscapedNewline();
   void testEscapedNewline_data();
@@ -64,6 +66,9 @@ private slots:
   void testPreprocessorStringify();
   void testStringConcatenation();
   void testEmptyInclude();
+  void testIncludeScanner();
+  void benchmarkPreprocessor_data();
+  void benchmarkPreprocessor();
 
   void testCondition();
   void testNonTemplateDeclaration();
@@ -0,0 +1,240 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "parsescheduler.h"
+#include "cpputils.h"
+#include "rpp/preprocessor.h"
+#include "debug.h"
+
+#include <interfaces/icore.h>
+#include <interfaces/iproject.h>
+#include <interfaces/iprojectcontroller.h>
+#include <interfaces/ilanguagecontroller.h>
+#include <language/backgroundparser/backgroundparser.h>
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/topducontext.h>
+#include <language/editor/modificationrevision.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+using namespace KDevelop;
+
+namespace {
+
+///Files with a larger include-height are all scheduled like files of this height
+const int maxScheduledHeight = 100;
+
+typedef QHash<IndexedString, int> IncludeHeights;
+
+///Computes the include-height of @p file. A file that is currently being computed counts as height 0, which breaks include-cycles.
+int includeHeight(const IndexedString& file, const QHash<IndexedString, QVector<IndexedString> >& includes,
+                  IncludeHeights& heights)
+{
+  IncludeHeights::const_iterator known = heights.constFind(file);
+  if(known != heights.constEnd())
+    return *known;
+  heights.insert(file, 0);
+
+  int height = 0;
+  foreach(const IndexedString& included, includes.value(file))
+    height = qMax(height, includeHeight(included, includes, heights) + 1);
+
+  heights.insert(file, height);
+  return height;
+}
+
+///Length of the directory-path shared by both files
+int commonDirectoryLength(const QString& lhs, const QString& rhs)
+{
+  int ret = 0;
+  for(int a = 0; a < lhs.size() && a < rhs.size() && lhs[a] == rhs[a]; ++a)
+    if(lhs[a] == '/')
+      ret = a + 1;
+  return ret;
+}
+
+///Whether each of the files was parsed before, and has not been modified on disk since
+bool parsedInCurrentVersion(const QSet<IndexedString>& files)
+{
+  foreach(const IndexedString& file, files) {
+    const ModificationRevision revision = ModificationRevision::revisionForFile(file);
+    bool current = false;
+    DUChainReadLocker lock;
+    foreach(const ParsingEnvironmentFilePointer& environment, DUChain::self()->allEnvironmentFiles(file))
+      if(environment->modificationRevision() == revision)
+        current = true;
+    if(!current)
+      return false;
+  }
+  return true;
+}
+
+}
+
+ParseScheduler::ParseScheduler(QObject* parent)
+  : QObject(parent)
+{
+  connect(ICore::self()->projectController(), &IProjectController::projectOpened, this, &ParseScheduler::projectOpened);
+}
+
+QHash<IndexedString, int> ParseScheduler::includeHeights(const QSet<IndexedString>& files, const HeightsFound& found, int batchSize)
+{
+  QHash<QString, QVector<IndexedString> > filesByName;
+  foreach(const IndexedString& file, files)
+    filesByName[QFileInfo(file.str()).fileName()] << file;
+
+  QHash<IndexedString, QVector<IndexedString> > includes;
+  IncludeHeights heights;
+  IncludeHeights batch;
+  ///Scanned files whose height is not known yet, with the count of included files it still depends on
+  QHash<IndexedString, int> waiting;
+  ///The waiting files by the files they depend on
+  QHash<IndexedString, QVector<IndexedString> > dependents;
+
+  rpp::IncludeScanner scanner;
+  int scanned = 0;
+  foreach(const IndexedString& file, files) {
+    const QString path = file.str();
+    const QString directory = QFileInfo(path).path() + '/';
+    QVector<IndexedString> fileIncludes;
+    foreach(const rpp::IncludeScanner::Include& include, scanner.scan(path)) {
+      //Prefer the file next to the including one, as the preprocessor does for local includes
+      IndexedString resolved(QDir::cleanPath(directory + include.name));
+      if(!files.contains(resolved)) {
+        resolved = IndexedString();
+        int bestCommonLength = -1;
+        foreach(const IndexedString& candidate, filesByName.value(QFileInfo(include.name).fileName())) {
+          const QString candidatePath = candidate.str();
+          if(candidate == file || !candidatePath.endsWith('/' + include.name))
+            continue;
+          const int commonLength = commonDirectoryLength(path, candidatePath);
+          if(commonLength > bestCommonLength || (commonLength == bestCommonLength && candidatePath < resolved.str())) {
+            resolved = candidate;
+            bestCommonLength = commonLength;
+          }
+        }
+      }
+      if(!resolved.isEmpty() && resolved != file && !fileIncludes.contains(resolved))
+        fileIncludes << resolved;
+    }
+    includes.insert(file, fileIncludes);
+
+    int unknown = 0;
+    foreach(const IndexedString& included, fileIncludes) {
+      if(!heights.contains(included)) {
+        ++unknown;
+        dependents[included] << file;
+      }
+    }
+
+    //Once a height is known, the files waiting for it may be complete
+    QVector<IndexedString> complete;
+    if(unknown)
+      waiting.insert(file, unknown);
+    else
+      complete << file;
+    while(!complete.isEmpty()) {
+      const IndexedString done = complete.takeLast();
+      int height = 0;
+      foreach(const IndexedString& included, includes[done])
+        height = qMax(height, heights[included] + 1);
+      heights.insert(done, height);
+      batch.insert(done, height);
+      foreach(const IndexedString& dependent, dependents.take(done)) {
+        QHash<IndexedString, int>::iterator count = waiting.find(dependent);
+        if(--(*count) == 0) {
+          waiting.erase(count);
+          complete << dependent;
+        }
+      }
+    }
+
+    if(found && ++scanned % batchSize == 0 && !batch.isEmpty()) {
+      found(batch);
+      batch.clear();
+    }
+  }
+
+  //The files still waiting are in include-cycles, or depend on files that are
+  foreach(const IndexedString& file, waiting.keys())
+    batch.insert(file, includeHeight(file, includes, heights));
+
+  if(found && !batch.isEmpty())
+    found(batch);
+  return heights;
+}
+
+void ParseScheduler::projectOpened(IProject* project)
+{
+  const QStringList extensions = CppUtils::headerExtensions() + CppUtils::sourceExtensions();
+  QSet<IndexedString> files;
+  foreach(const IndexedString& file, project->fileSet())
+    if(extensions.contains(QFileInfo(file.str()).suffix()))
+      files.insert(file);
+
+  if(files.isEmpty())
+    return;
+
+  QFutureInterface<IncludeHeights> heights;
+  heights.reportStarted();
+  QFutureWatcher<IncludeHeights>* watcher = new QFutureWatcher<IncludeHeights>(this);
+  connect(watcher, &QFutureWatcher<IncludeHeights>::resultReadyAt, this, &ParseScheduler::includeHeightsFound);
+  connect(watcher, &QFutureWatcher<IncludeHeights>::finished, this, &ParseScheduler::includeHeightsFinished);
+  watcher->setFuture(heights.future());
+
+  QtConcurrent::run([heights, files] () mutable {
+    //Then the parse-jobs only find the files up to date, in whatever order
+    if(!parsedInCurrentVersion(files)) {
+      int batch = 0;
+      includeHeights(files, [&heights, &batch] (const IncludeHeights& found) {
+        heights.reportResult(found, batch++);
+      });
+    }
+    heights.reportFinished();
+  });
+}
+
+void ParseScheduler::includeHeightsFound(int batch)
+{
+  QFutureWatcher<IncludeHeights>* watcher = dynamic_cast<QFutureWatcher<IncludeHeights>*>(sender());
+  Q_ASSERT(watcher);
+  const IncludeHeights heights = watcher->resultAt(batch);
+
+  //Only files that are still waiting are moved forward. Adding a target without features does not change what is
+  //computed for the file, the background-parser merges it into the existing parse-plan and uses its best priority.
+  BackgroundParser* parser = ICore::self()->languageController()->backgroundParser();
+  int scheduled = 0;
+  for(IncludeHeights::const_iterator it = heights.constBegin(); it != heights.constEnd(); ++it) {
+    if(!parser->isQueued(it.key()))
+      continue;
+    const int priority = BackgroundParser::InitialParsePriority - maxScheduledHeight - 1 + qMin(*it, maxScheduledHeight);
+    parser->addDocument(it.key(), TopDUContext::Empty, priority);
+    ++scheduled;
+  }
+
+  qCDebug(CPP) << "ordered" << scheduled << "of" << heights.size() << "project files by their include-height";
+}
+
+void ParseScheduler::includeHeightsFinished()
+{
+  sender()->deleteLater();
+}
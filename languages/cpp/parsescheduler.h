@@ -0,0 +1,73 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef PARSESCHEDULER_H
+#define PARSESCHEDULER_H
+
+#include <serialization/indexedstring.h>
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+
+#include <functional>
+
+namespace KDevelop {
+class IProject;
+}
+
+/**
+ * Orders the initial parsing of a project along its include-graph.
+ *
+ * When a project is opened, all its files are queued in the background-parser with the same priority, and the
+ * parse-jobs of many source-files end up waiting for each other while preprocessing the same popular headers.
+ * This scans the #include lines of the project files in a background thread, and raises the priority of the
+ * queued files so that headers that include no other project files are parsed first, and each file is parsed after
+ * the project files it includes. The parse-jobs of the including files then find the headers already parsed.
+ *
+ * The heights are delivered in batches while the scan runs, the lowest ones come first. Only the files that are
+ * queued when their batch arrives are reordered. If every project file was already parsed in its current version,
+ * nothing is scanned.
+ */
+class ParseScheduler : public QObject
+{
+  Q_OBJECT
+public:
+  explicit ParseScheduler(QObject* parent = 0);
+
+  typedef std::function<void (const QHash<KDevelop::IndexedString, int>&)> HeightsFound;
+
+  /**
+   * Returns the include-height of each of the given files: 0 for a file that includes none of the other files,
+   * otherwise one more than the largest include-height of the included files.
+   * The files are only scanned for their directives, with the includes of all #if branches counting, since the macros
+   * that decide them are unknown. Include-names are resolved against the given files only. A name that is not next
+   * to the including file picks the candidate closest to it, standing in for the include-paths, which are unknown.
+   * @param found If given, it is called after every @p batchSize scanned files with the heights that became known since
+   *              the last call. A height is known once all files it depends on are scanned. Files in include-cycles only
+   *              get theirs in the last call.
+   * Can be called from any thread.
+   */
+  static QHash<KDevelop::IndexedString, int> includeHeights(const QSet<KDevelop::IndexedString>& files,
+                                                            const HeightsFound& found = HeightsFound(), int batchSize = 100);
+
+private slots:
+  void projectOpened(KDevelop::IProject* project);
+  void includeHeightsFound(int batch);
+  void includeHeightsFinished();
+};
+
+#endif // PARSESCHEDULER_H
@@ -51,6 +51,8 @@
 #include "parser/rpp/pp-macro.h"
 #include "parser/rpp/preprocessor.h"
 #include "environmentmanager.h"
+#include "proxycontextstatistics.h"
+#include "globalsymbolindex.h"
 #include "cpppreprocessenvironment.h"
 
 #include "cppdebughelper.h"
@@ -72,6 +74,29 @@ static QString pathsToString(const Path::List& paths)
   return str;
 }
 
+///Finds out why none of the content-contexts of @p document could be used, for the proxy-context statistics. The DUChain must be read-locked.
+static QString contentMismatch(const KDevelop::IndexedString& document, const CppPreprocessEnvironment* environment, uint identityOffset)
+{
+  bool hadContent = false, hadSameBranching = false;
+  foreach( const KDevelop::ParsingEnvironmentFilePointer& file, KDevelop::DUChain::self()->allEnvironmentFiles(document) ) {
+    const Cpp::EnvironmentFile* cppFile = dynamic_cast<const Cpp::EnvironmentFile*>(file.data());
+    if( !cppFile || cppFile->isProxyContext() )
+      continue;
+    hadContent = true;
+    if( cppFile->identityOffset() != identityOffset )
+      continue;
+    hadSameBranching = true;
+    QString mismatch;
+    if( !cppFile->matchEnvironment(environment, &mismatch) )
+      return mismatch;
+  }
+  if( !hadContent )
+    return QStringLiteral("no content-context yet");
+  if( !hadSameBranching )
+    return QStringLiteral("different branching in the header-section");
+  return QStringLiteral("no usable content-context");
+}
+
 PreprocessJob::PreprocessJob(CPPParseJob * parent)
     : m_parentJob(parent)
     , m_currentEnvironment(0)
@@ -179,7 +204,16 @@ void PreprocessJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread* thr
             Cpp::EnvironmentFile* cppEnv = dynamic_cast<Cpp::EnvironmentFile*>(updatingEnvironmentFile.data());
             Q_ASSERT(cppEnv);
             //When possible, we determine whether an update is needed without getting the include-paths, because that's very expensive
-            bool needsUpdate = cppEnv->needsUpdate();
+            QList<KDevelop::IndexedString> unhashedFiles;
+            bool needsUpdate = cppEnv->needsUpdate(0, &unhashedFiles);
+            if(needsUpdate && !unhashedFiles.isEmpty()) {
+              //Touched files are compared by the hashes of their contents, which are computed without the DUChain locked
+              readLock.unlock();
+              Cpp::EnvironmentFile::hashFilesOnDisk(unhashedFiles);
+              readLock.lock();
+
+              needsUpdate = cppEnv->needsUpdate();
+            }
               if(!cppEnv->missingIncludeFiles().isEmpty() && !needsUpdate) {
                 for(Cpp::ReferenceCountedStringSet::Iterator it = cppEnv->missingIncludeFiles().iterator(); it; ++it)
                   qCDebug(CPP) << updatingEnvironmentFile->url().str() << "has missing include:" << (*it).str();
@@ -192,6 +226,8 @@ void PreprocessJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread* thr
               }
 
             if(!needsUpdate) {
+              readLock.unlock();
+              Cpp::EnvironmentFile::refreshTouchedRevisions();
               parentJob()->setNeedsUpdate(false);
               return;
             }
@@ -283,6 +319,7 @@ void PreprocessJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread* thr
     if(m_secondEnvironmentFile) {//Copy some information from the environment-file to its content-part
         KDevelop::DUChainWriteLocker readLock(KDevelop::DUChain::lock());
         m_secondEnvironmentFile->setModificationRevision(m_firstEnvironmentFile->modificationRevision());
+        m_secondEnvironmentFile->setContentHash(m_firstEnvironmentFile->contentHash());
         if(m_firstEnvironmentFile->headerGuard().isEmpty())
           m_firstEnvironmentFile->setHeaderGuard(m_secondEnvironmentFile->headerGuard());
         else
@@ -372,8 +409,11 @@ void PreprocessJob::headerSectionEndedInternal(rpp::Stream* stream)
             ///@todo think whether localPath is needed
             Path localPath = Path(parentJob()->document().str()).parent();
 
-            if(contentEnvironment->matchEnvironment(m_currentEnvironment) && !CppUtils::needsUpdate(contentEnvironment, localPath, parentJob()->includePathUrls()) && (!parentJob()->masterJob()->needUpdateEverything() || parentJob()->masterJob()->wasUpdated(content)) && (content->parsingEnvironmentFile()->featuresSatisfied(parentJob()->minimumFeatures()) && content->parsingEnvironmentFile()->featuresSatisfied(parentJob()->slaveMinimumFeatures()))
+            QString mismatch;
+            if(contentEnvironment->matchEnvironment(m_currentEnvironment, Cpp::ProxyContextStatistics::isEnabled() ? &mismatch : 0) && !CppUtils::needsUpdate(contentEnvironment, localPath, parentJob()->includePathUrls()) && (!parentJob()->masterJob()->needUpdateEverything() || parentJob()->masterJob()->wasUpdated(content)) && (content->parsingEnvironmentFile()->featuresSatisfied(parentJob()->minimumFeatures()) && content->parsingEnvironmentFile()->featuresSatisfied(parentJob()->slaveMinimumFeatures()))
               && Cpp::EnvironmentManager::self()->matchingLevel() != Cpp::EnvironmentManager::Disabled) {
+                Cpp::ProxyContextStatistics::contentContextReused(u);
+
               ///@todo We never keep the duchain while updating now in disabled environment matching mode.
               ///           We don't need it there, and changes in imports may be simply ignored when the keeping is enabled.
               ///           However when full environment management is enabled this is needed, as the same content may be shared for multiple proxy contexts.
@@ -390,6 +430,8 @@ void PreprocessJob::headerSectionEndedInternal(rpp::Stream* stream)
                 Q_ASSERT(m_secondEnvironmentFile);
             } else {
                 ifDebug( qCDebug(CPP) << "updating content-context"; )
+                if(Cpp::ProxyContextStatistics::isEnabled())
+                  Cpp::ProxyContextStatistics::contentContextMissed(u, mismatch.isEmpty() ? QStringLiteral("content-context needs an update") : mismatch);
                 m_updatingEnvironmentFile = QExplicitlySharedDataPointer<Cpp::EnvironmentFile>(dynamic_cast<Cpp::EnvironmentFile*>(content->parsingEnvironmentFile().data()));
                 //We will re-use the specialized context, but it needs updating. So we keep processing here.
                 //We don't need to change m_updatingEnvironmentFile, because we will create a new one.
@@ -397,6 +439,8 @@ void PreprocessJob::headerSectionEndedInternal(rpp::Stream* stream)
         } else {
             //We need to process the content ourselves
             ifDebug( qCDebug(CPP) << "could not find a matching content-context"; )
+            if(Cpp::ProxyContextStatistics::isEnabled())
+              Cpp::ProxyContextStatistics::contentContextMissed(u, contentMismatch(u, m_currentEnvironment, m_secondEnvironmentFile->identityOffset()));
         }
 
         m_currentEnvironment->finishEnvironment();
@@ -538,6 +582,9 @@ rpp::Stream* PreprocessJob::sourceNeeded(QString& fileName, IncludeType type, in
         if( includedContext && (updateForbidden || (!updateNeeded && (!parentJob()->masterJob()->needUpdateEverything() || parentJob()->masterJob()->wasUpdated(includedContext)))) ) {
             ifDebug( qCDebug(CPP) << "PreprocessJob" << parentJob()->document().str() << ": took included file from the du-chain" << fileName; )
 
+            //Headers reused from an earlier session are never parsed, so they are indexed here
+            Cpp::GlobalSymbolIndex::ensureDocument(indexedFile);
+
             KDevelop::DUChainReadLocker readLock(KDevelop::DUChain::lock());
             parentJob()->addIncludedFile(includedContext, sourceLine);
             KDevelop::ParsingEnvironmentFilePointer file = includedContext->parsingEnvironmentFile();
@@ -655,6 +702,7 @@ bool PreprocessJob::readContents()
     return false;
   }
   m_firstEnvironmentFile->setModificationRevision( parentJob()->contents().modification );
+  m_firstEnvironmentFile->setContentHash( Cpp::EnvironmentFile::hashContents(parentJob()->contents().contents) );
 
   m_contents = parentJob()->contents().contents;
 
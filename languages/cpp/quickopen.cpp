@@ -226,6 +226,31 @@ QList<IncludeItem> getAllIncludedItems( TopDUContextPointer ctx, QString prefixP
   return ret.values();
 }
 
+QList<IncludeItem> IncludeFileDataProvider::includedItems( const QString& prefixPath ) const
+{
+  if( prefixPath.isEmpty() )
+    return m_includedItems;
+
+  QList<IncludeItem> ret;
+  foreach( const IncludeItem& item, m_includedItems )
+    if( item.name.contains(prefixPath) )
+      ret << item;
+  return ret;
+}
+
+QList<IncludeItem> IncludeFileDataProvider::includePathItems( const QString& prefixPath, const QStringList& addIncludePaths, bool explicitPath )
+{
+  //While typing, the same prefixes are searched again and again, so the directory listings are only done once per reset()
+  const QString key = prefixPath + '\n' + addIncludePaths.join(QStringLiteral("\n")) + (explicitPath ? '1' : '0');
+  QHash<QString, QList<IncludeItem> >::const_iterator it = m_includePathItems.constFind(key);
+  if( it != m_includePathItems.constEnd() )
+    return *it;
+
+  const QList<IncludeItem> ret = CppUtils::allFilesInIncludePath( m_baseUrl.toLocalFile(), true, prefixPath, addIncludePaths, explicitPath, true, true );
+  m_includePathItems.insert(key, ret);
+  return ret;
+}
+
 void IncludeFileDataProvider::setFilterText( const QString& _text )
 {
   QString text(_text);
@@ -276,10 +301,10 @@ void IncludeFileDataProvider::setFilterText( const QString& _text )
       qCDebug(CPP) << "extracted prefix " << prefixPath;
 
       if( m_allowPossibleImports || explicitPath )
-        allIncludeItems += CppUtils::allFilesInIncludePath( m_baseUrl.toLocalFile(), true, prefixPath, addIncludePaths, explicitPath, true, true );
+        allIncludeItems += includePathItems( prefixPath, addIncludePaths, explicitPath );
 
       if( m_allowImports )
-        allIncludeItems += getAllIncludedItems( m_duContext, prefixPath );
+        allIncludeItems += includedItems( prefixPath );
 
         setItems( allIncludeItems );
 
@@ -302,6 +327,9 @@ void IncludeFileDataProvider::reset()
   m_duContext = TopDUContextPointer();
   m_baseUrl = QUrl();
   m_importers.clear();
+  m_includedItems.clear();
+  m_includedFiles.clear();
+  m_includePathItems.clear();
 
   IDocument* doc = ICore::self()->documentController()->activeDocument();
 
@@ -325,11 +353,17 @@ void IncludeFileDataProvider::reset()
 
   QList<IncludeItem> allIncludeItems;
 
+  //The included files are also needed by data() to mark the items, so they are collected even if not listed
+  m_includedItems = getAllIncludedItems( m_duContext );
+  foreach( const IncludeItem& item, m_includedItems )
+    m_includedFiles.insert( IndexedString(item.name) );
+  m_includedFiles.remove( IndexedString(m_baseUrl) );
+
   if( m_allowPossibleImports )
-    allIncludeItems += CppUtils::allFilesInIncludePath( m_baseUrl.toLocalFile(), true, QString(), QStringList(), false, true, true );
+    allIncludeItems += includePathItems( QString(), QStringList(), false );
 
   if( m_allowImports )
-    allIncludeItems += getAllIncludedItems( m_duContext );
+    allIncludeItems += m_includedItems;
 
   foreach( const IndexedString &u, m_importers ) {
     IncludeItem i;
@@ -358,25 +392,9 @@ QuickOpenDataPointer IncludeFileDataProvider::data( uint row ) const
 {
   const QList<KDevelop::IncludeItem>& items( filteredItems() );
 
-  DUChainReadLocker lock( DUChain::lock() );
-  //Find out whether the url is included into the current file
-  bool isIncluded = false;
-
-  if( m_duContext )
-  {
-    QUrl u = items[row].url();
-
-    QList<TopDUContext*> allChains = DUChain::self()->chainsForDocument(u);
-
-    foreach( TopDUContext* t, allChains )
-    {
-      if( m_duContext.data()->imports( t, m_duContext->range().end ) )
-      {
-        isIncluded = true;
-        break;
-      }
-    }
-  }
+  //Find out whether the url is included into the current file. This is called for each visible row
+  //while typing, so it uses the includes collected on reset() instead of locking the DUChain.
+  const bool isIncluded = m_duContext && m_includedFiles.contains( IndexedString(items[row].url()) );
 
   //If it is an importer(marked by pathNumber -1), give m_duContext so we can search the inclusion-path later
   return QuickOpenDataPointer( new IncludeFileData( items[row], ( isIncluded || items[row].pathNumber == -1 ) ? m_duContext : TopDUContextPointer() ) );
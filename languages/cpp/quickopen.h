@@ -82,6 +82,8 @@ class IncludeFileDataProvider: public KDevelop::QuickOpenDataProviderBase, publi
     void documentDestroyed( QObject* obl );
 
   private:
+    QList<KDevelop::IncludeItem> includedItems( const QString& prefixPath ) const;
+    QList<KDevelop::IncludeItem> includePathItems( const QString& prefixPath, const QStringList& addIncludePaths, bool explicitPath );
 
     QUrl m_baseUrl;
     QString m_lastSearchedPrefix;
@@ -92,6 +94,13 @@ class IncludeFileDataProvider: public KDevelop::QuickOpenDataProviderBase, publi
 
     ///Cache for all documents that import the current one
     QList<KDevelop::IndexedString> m_importers;
+
+    ///All documents the current one includes, directly or indirectly, collected once on reset()
+    QList<KDevelop::IncludeItem> m_includedItems;
+    QSet<KDevelop::IndexedString> m_includedFiles;
+
+    ///Cache for the include-path listings searched since the last reset(), by prefix and additional include-paths
+    QHash<QString, QList<KDevelop::IncludeItem> > m_includePathItems;
   
     KDevelop::TopDUContextPointer m_duContext;
 };
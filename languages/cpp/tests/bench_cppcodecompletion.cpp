@@ -0,0 +1,177 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bench_cppcodecompletion.h"
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+#include <tests/testfile.h>
+#include <tests/testproject.h>
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainutils.h>
+#include <language/codegen/coderepresentation.h>
+
+#include "codecompletion/context.h"
+#include "codecompletion/item.h"
+
+#include <QElapsedTimer>
+#include <QTest>
+
+#include <algorithm>
+
+using namespace KDevelop;
+
+QTEST_MAIN(BenchCppCodeCompletion)
+
+namespace {
+///Size of the synthetic project
+const int headerCount = 40;
+const int classesPerHeader = 25;
+const int membersPerClass = 20;
+///Completion requests per case
+const int iterations = 50;
+
+///A header declaring a namespace with a chain of classes, each derived from the previous one
+QString syntheticHeader(int header)
+{
+  QString ret = QString("namespace Ns%1 {\n").arg(header);
+  for(int c = 0; c < classesPerHeader; ++c) {
+    ret += QString("class Class%1_%2").arg(header).arg(c);
+    if(c > 0)
+      ret += QString(" : public Class%1_%2").arg(header).arg(c - 1);
+    ret += " {\npublic:\n";
+    for(int m = 0; m < membersPerClass; ++m)
+      ret += QString("  int member%1_%2;\n  Class%3_%1* method%1_%2(int a, const char* b);\n").arg(c).arg(m).arg(header);
+    ret += QString("  static Class%1_%2* create();\n};\n").arg(header).arg(c);
+  }
+  ret += QString("Class%1_0* globalFunction%1(int a);\n}\n").arg(header);
+  return ret;
+}
+
+qint64 percentile(const QVector<qint64>& sorted, int percent)
+{
+  return sorted[qMin(sorted.size() - 1, sorted.size() * percent / 100)];
+}
+}
+
+void BenchCppCodeCompletion::initTestCase()
+{
+  AutoTestShell::init(QStringList() << "kdevcppsupport");
+  TestCore::initialize(Core::NoUi);
+  TestCore* core = dynamic_cast<TestCore*>(TestCore::self());
+  QVERIFY(core);
+
+  DUChain::self()->disablePersistentStorage();
+  CodeRepresentation::setDiskChangesForbidden(true);
+
+  m_projects = new TestProjectController(core);
+  core->setProjectController(m_projects);
+  TestProject* project = new TestProject;
+  m_projects->addProject(project);
+
+  QString includes;
+  for(int header = 0; header < headerCount; ++header) {
+    TestFile* file = new TestFile(syntheticHeader(header), "h", project);
+    file->parse(TopDUContext::AllDeclarationsAndContexts);
+    QVERIFY(file->waitForParsed(60000));
+    includes += "#include \"" + file->url().toUrl().fileName() + "\"\n";
+    m_files << file;
+  }
+
+  const QString last = QString("Ns%1::Class%1_%2").arg(headerCount - 1).arg(classesPerHeader - 1);
+  TestFile* source = new TestFile(includes + "void benchmarkFunction(" + last + "* pointer) { " + last + " local;\n}\n", "cpp", project);
+  source->parse(TopDUContext::AllDeclarationsAndContexts);
+  QVERIFY(source->waitForParsed(60000));
+  m_files << source;
+}
+
+void BenchCppCodeCompletion::cleanupTestCase()
+{
+  qDeleteAll(m_files);
+  TestCore::shutdown();
+}
+
+void BenchCppCodeCompletion::benchCompletion_data()
+{
+  QTest::addColumn<QString>("text");
+
+  const QString last = QString("Class%1_%2").arg(headerCount - 1).arg(classesPerHeader - 1);
+  QTest::newRow("global") << QString();
+  QTest::newRow("member access") << "local.";
+  QTest::newRow("arrow member access") << "pointer->";
+  QTest::newRow("static member choose") << QString("Ns%1::%2::").arg(headerCount - 1).arg(last);
+  QTest::newRow("namespace") << QString("Ns%1::").arg(headerCount / 2);
+  QTest::newRow("function call") << "local.method0_0(";
+  QTest::newRow("binary operator") << "int i = local.member0_0 + ";
+  QTest::newRow("return") << "return ";
+}
+
+void BenchCppCodeCompletion::benchCompletion()
+{
+  QFETCH(QString, text);
+
+  DUChainReadLocker lock;
+  TopDUContext* top = DUChainUtils::contentContextFromProxyContext(m_files.last()->topContext().data());
+  QVERIFY(top);
+  DUContext* body = top->childContexts().last();
+  QCOMPARE(body->type(), DUContext::Other);
+  const CursorInRevision position = body->range().end;
+  lock.unlock();
+
+  QVector<qint64> latencies;
+  QMap<QString, qint64> phaseTimes;
+  int itemCount = 0;
+  for(int a = 0; a < iterations; ++a) {
+    QElapsedTimer timer;
+    timer.start();
+
+    //The same steps as Cpp::CodeCompletionWorker::computeCompletions
+    Cpp::CodeCompletionContext::Ptr context(new Cpp::CodeCompletionContext(DUContextPointer(body), text, QString(), position));
+    QVERIFY(context->isValid());
+    context->setExpensiveGroupsInBackground(true);
+    bool abort = false;
+    QList<CompletionTreeItemPointer> items = context->completionItems(abort);
+    while(context->waitForExpensiveGroup(abort))
+      context->ungroupedElements();
+
+    QElapsedTimer presentationTimer;
+    presentationTimer.start();
+    lock.lock();
+    foreach(const CompletionTreeItemPointer& item, items) {
+      if(Cpp::NormalDeclarationCompletionItem* normalItem = dynamic_cast<Cpp::NormalDeclarationCompletionItem*>(item.data()))
+        normalItem->prepareDisplayData();
+    }
+    lock.unlock();
+    context->addPhaseTime(QStringLiteral("presentation"), presentationTimer.nsecsElapsed());
+
+    latencies << timer.nsecsElapsed();
+    itemCount = items.size();
+    const QMap<QString, qint64> times = context->phaseTimes();
+    for(QMap<QString, qint64>::const_iterator it = times.constBegin(); it != times.constEnd(); ++it)
+      phaseTimes[it.key()] += it.value();
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  qDebug() << QTest::currentDataTag() << ":" << itemCount << "items, p50" << percentile(latencies, 50) / 1000 << "us, p99"
+           << percentile(latencies, 99) / 1000 << "us";
+  for(QMap<QString, qint64>::const_iterator it = phaseTimes.constBegin(); it != phaseTimes.constEnd(); ++it)
+    qDebug() << "    " << it.key() << ":" << it.value() / iterations / 1000 << "us on average";
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef BENCH_CPPCODECOMPLETION_H
+#define BENCH_CPPCODECOMPLETION_H
+
+#include <QObject>
+#include <QList>
+
+namespace KDevelop
+{
+class TestFile;
+class TestProjectController;
+}
+
+/**
+ * Measures the latency of code-completion requests in a synthetic large project.
+ *
+ * Each case is a completion kind covered by test_cppcodecompletion. It is requested repeatedly,
+ * and the 50th and 99th percentile of the latency is reported, together with the time spent per phase.
+ */
+class BenchCppCodeCompletion : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchCompletion_data();
+    void benchCompletion();
+
+private:
+    KDevelop::TestProjectController* m_projects;
+    QList<KDevelop::TestFile*> m_files;
+};
+
+#endif // BENCH_CPPCODECOMPLETION_H
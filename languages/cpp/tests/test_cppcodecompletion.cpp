@@ -65,6 +65,7 @@
 #include <interfaces/iplugincontroller.h>
 
 #include <QTemporaryDir>
+#include <QtConcurrentRun>
 #include <KTextEditor/Editor>
 #include <KTextEditor/View>
 
@@ -3676,6 +3677,112 @@ void TestCppCodeCompletion::testMultipleIncludeCompletionItems()
   QCOMPARE(includeItems[0].basePath, QUrl::fromLocalFile(innerDir1.absolutePath()));
 }
 
+/**
+ * Check that the listing of include directories is updated when files are added
+ */
+void TestCppCodeCompletion::testIncludeDirectoryChanges()
+{
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  QDir dir(tempDir.path());
+  QFile file1(dir.absoluteFilePath("xxxxx1.h"));
+  QVERIFY(file1.open(QIODevice::ReadWrite));
+  QList<IncludeItem> includeItems = CppUtils::allFilesInIncludePath(dir.absoluteFilePath("source.cpp"), false, QString(), QStringList() << tempDir.path(), true);
+  QCOMPARE(includeItems.size(), 1);
+
+  QFile file2(dir.absoluteFilePath("xxxxx2.h"));
+  QVERIFY(file2.open(QIODevice::ReadWrite));
+  QTRY_COMPARE(CppUtils::allFilesInIncludePath(dir.absoluteFilePath("source.cpp"), false, QString(), QStringList() << tempDir.path(), true).size(), 2);
+}
+
+/**
+ * Check that a listing read from a background thread is only kept once the directory is watched,
+ * and that changes after the watch was added are noticed
+ */
+void TestCppCodeCompletion::testIncludeDirectoryChangesFromBackground()
+{
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  QDir dir(tempDir.path());
+  const QString source = dir.absoluteFilePath("source.cpp");
+  const QStringList includePaths = QStringList() << tempDir.path();
+  QFile file1(dir.absoluteFilePath("xxxxx1.h"));
+  QVERIFY(file1.open(QIODevice::ReadWrite));
+
+  auto listInBackground = [&]() {
+    return QtConcurrent::run([&]() {
+      return CppUtils::allFilesInIncludePath(source, false, QString(), includePaths, true).size();
+    }).result();
+  };
+  QCOMPARE(listInBackground(), 1);
+
+  //The watch is still queued, so the listing must not have been kept
+  QFile file2(dir.absoluteFilePath("xxxxx2.h"));
+  QVERIFY(file2.open(QIODevice::ReadWrite));
+  QCOMPARE(listInBackground(), 2);
+
+  //Adds the queued watch, after which listings are kept until the directory changes
+  QCoreApplication::processEvents();
+  QCOMPARE(listInBackground(), 2);
+
+  QFile file3(dir.absoluteFilePath("xxxxx3.h"));
+  QVERIFY(file3.open(QIODevice::ReadWrite));
+  QTRY_COMPARE(listInBackground(), 3);
+}
+
+/**
+ * Check that includes which could not be found are found once they are created
+ */
+void TestCppCodeCompletion::testFindIncludeCache()
+{
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  QDir dir(tempDir.path());
+  const Path::List includePaths = Path::List() << Path(tempDir.path());
+
+  auto included = CppUtils::findInclude(includePaths, Path(), "sub/xxxxx.h", rpp::Preprocessor::IncludeGlobal, Path(), true);
+  QVERIFY(!included.first.isValid());
+
+  QVERIFY(dir.mkdir("sub"));
+  QFile file(dir.absoluteFilePath("sub/xxxxx.h"));
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QTRY_VERIFY(CppUtils::findInclude(includePaths, Path(), "sub/xxxxx.h", rpp::Preprocessor::IncludeGlobal, Path(), true).first.isValid());
+
+  included = CppUtils::findInclude(includePaths, Path(), "sub/xxxxx.h", rpp::Preprocessor::IncludeGlobal, Path(), true);
+  QCOMPARE(included.first, Path(dir.absoluteFilePath("sub/xxxxx.h")));
+  QCOMPARE(included.second, includePaths.first());
+}
+
+/**
+ * Check that includes with "." and ".." segments are found, they are checked without a watched directory
+ */
+void TestCppCodeCompletion::testFindRelativeInclude()
+{
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  QDir dir(tempDir.path());
+  QVERIFY(dir.mkdir("sub"));
+  QFile file(dir.absoluteFilePath("xxxxx.h"));
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QFile subFile(dir.absoluteFilePath("sub/yyyyy.h"));
+  QVERIFY(subFile.open(QIODevice::ReadWrite));
+  const Path subPath(dir.absoluteFilePath("sub"));
+
+  auto included = CppUtils::findInclude(Path::List(), subPath, "../xxxxx.h", rpp::Preprocessor::IncludeLocal, Path(), true);
+  QCOMPARE(included.first, Path(dir.absoluteFilePath("xxxxx.h")));
+
+  included = CppUtils::findInclude(Path::List(), subPath, "./yyyyy.h", rpp::Preprocessor::IncludeLocal, Path(), true);
+  QCOMPARE(included.first, Path(dir.absoluteFilePath("sub/yyyyy.h")));
+
+  included = CppUtils::findInclude(Path::List() << subPath, Path(), "../sub/yyyyy.h", rpp::Preprocessor::IncludeGlobal, Path(), true);
+  QCOMPARE(included.first, Path(dir.absoluteFilePath("sub/yyyyy.h")));
+
+  //The results are not cached, so a removed file is noticed at once
+  QVERIFY(subFile.remove());
+  included = CppUtils::findInclude(Path::List(), subPath, "./yyyyy.h", rpp::Preprocessor::IncludeLocal, Path(), true);
+  QVERIFY(!included.first.isValid());
+}
+
 void TestCppCodeCompletion::testAfterVisibility_data()
 {
   QTest:: addColumn<QString>("vis");
@@ -3786,6 +3893,89 @@ void TestCppCodeCompletion::testLookaheadMatches()
   release(top);
 }
 
+void TestCppCodeCompletion::testBackgroundGroups()
+{
+  QByteArray test = "struct One { int alsoRan; }; struct Two { One m_one; void test() { } };";
+  TopDUContext* top = parse(test, DumpNone);
+  DUChainWriteLocker lock(DUChain::lock());
+  DUContext* testContext = top->childContexts()[1]->childContexts()[1];
+
+  Cpp::CodeCompletionContext::Ptr context(new Cpp::CodeCompletionContext(DUContextPointer(testContext), "int foo = ", QString(), testContext->range().end));
+  QVERIFY(context->isValid());
+  context->setExpensiveGroupsInBackground(true);
+
+  auto groupNames = [&context]() {
+    QStringList names;
+    foreach(const CompletionTreeElementPointer& element, context->ungroupedElements()) {
+      if (CompletionCustomGroupNode* group = dynamic_cast<CompletionCustomGroupNode*>(element.data()))
+        names << group->roleValue.toString();
+    }
+    return names;
+  };
+
+  bool abort = false;
+  QVERIFY(!context->completionItems(abort).isEmpty());
+
+  //The groups computed in the background need the du-chain lock
+  lock.unlock();
+  while(context->waitForExpensiveGroup(abort)) {
+    //A finished group is added by the next call, and only once
+    const int groups = groupNames().size();
+    QCOMPARE(groupNames().size(), groups);
+  }
+  const QStringList names = groupNames();
+  QCOMPARE(names.count("Lookahead Matches"), 1);
+  //The groups are only added once
+  QCOMPARE(groupNames(), names);
+
+  //An aborted completion drops the groups that are still computed
+  context = Cpp::CodeCompletionContext::Ptr(new Cpp::CodeCompletionContext(DUContextPointer(testContext), "int foo = ", QString(), testContext->range().end));
+  context->setExpensiveGroupsInBackground(true);
+  lock.lock();
+  QVERIFY(!context->completionItems(abort).isEmpty());
+  abort = true;
+  QVERIFY(!context->waitForExpensiveGroup(abort));
+  lock.unlock();
+  abort = false;
+  while(context->waitForExpensiveGroup(abort)) {
+  }
+  QCOMPARE(groupNames().count("Lookahead Matches"), 0);
+  lock.lock();
+  release(top);
+}
+
+void TestCppCodeCompletion::testPrepareDisplayData()
+{
+  QByteArray test = "void foo(int a, char b); int bar; void test() { }";
+  TopDUContext* top = parse(test, DumpNone);
+  DUChainWriteLocker lock(DUChain::lock());
+
+  CompletionItemTester tester(top->childContexts()[2]);
+  QVERIFY(tester.names.contains("foo"));
+  QVERIFY(tester.names.contains("bar"));
+
+  QList<Cpp::NormalDeclarationCompletionItem*> prepared;
+  foreach(const CompletionTreeItemPointer& item, tester.items) {
+    Cpp::NormalDeclarationCompletionItem* normalItem = dynamic_cast<Cpp::NormalDeclarationCompletionItem*>(item.data());
+    if(normalItem && normalItem->declaration() && (normalItem->declaration()->identifier() == Identifier("foo") || normalItem->declaration()->identifier() == Identifier("bar"))) {
+      QVERIFY(!normalItem->isDisplayDataPrepared());
+      prepared << normalItem;
+    }
+  }
+  QCOMPARE(prepared.size(), 2);
+
+  foreach(Cpp::NormalDeclarationCompletionItem* item, prepared)
+    item->prepareDisplayData();
+  //Nothing is left to compute when the list asks for the data
+  foreach(Cpp::NormalDeclarationCompletionItem* item, prepared)
+    QVERIFY(item->isDisplayDataPrepared());
+
+  //The prepared data is what the list shows
+  QCOMPARE(tester.itemData("foo", KDevelop::CodeCompletionModel::Arguments).toString(), QString("(int a, char b)"));
+  QCOMPARE(tester.itemData("bar", KDevelop::CodeCompletionModel::Prefix).toString(), QString("int"));
+  release(top);
+}
+
 void TestCppCodeCompletion::testMemberAccessInstance()
 {
   QByteArray test = "struct foo{}; int main() {}";
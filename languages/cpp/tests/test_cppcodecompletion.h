@@ -145,6 +145,10 @@ private slots:
   void testFilterVoid();
   void testCompletedIncludeFilePath();
   void testMultipleIncludeCompletionItems();
+  void testIncludeDirectoryChanges();
+  void testIncludeDirectoryChangesFromBackground();
+  void testFindIncludeCache();
+  void testFindRelativeInclude();
   void testParentConstructor_data();
   void testParentConstructor();
   void testOverride_data();
@@ -157,6 +161,8 @@ private slots:
   void testNoQuadrupleColon();
   void testLookaheadMatches_data();
   void testLookaheadMatches();
+  void testBackgroundGroups();
+  void testPrepareDisplayData();
   void testMemberAccessInstance();
   void testNestedInlineNamespace();
   void testDuplicatedNamespace();
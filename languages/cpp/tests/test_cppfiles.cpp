@@ -34,7 +34,10 @@
 #include "cppjsontests.h"
 
 #include <QtTest/QTest>
+#include <QFile>
+#include <QFileInfo>
 #include <QProcessEnvironment>
+#include <QThread>
 
 using namespace KDevelop;
 using namespace Cpp;
@@ -60,15 +63,70 @@ public:
   }
 };
 
+namespace {
+
+///The test files, including those in the directory given by CPP_TEST_FILES_EXTRA_DIR, for example a large generated corpus
+QStringList testFilePaths()
+{
+  QStringList ret;
+  QStringList dirs;
+  dirs << CPP_TEST_FILES_DIR;
+  const QString extraDir = QProcessEnvironment::systemEnvironment().value("CPP_TEST_FILES_EXTRA_DIR");
+  if (!extraDir.isEmpty())
+    dirs << extraDir;
+
+  foreach (const QString& dirPath, dirs) {
+    foreach (const QString& file, QDir(dirPath).entryList(QStringList() << "*.cpp", QDir::Files))
+      ret << QString(dirPath + "/" + file);
+  }
+  return ret;
+}
+
+///The peak resident memory of the process in kB, if the platform reports it
+qint64 peakMemoryKb()
+{
+  QFile status("/proc/self/status");
+  if (!status.open(QIODevice::ReadOnly))
+    return -1;
+  foreach (const QByteArray& line, status.readAll().split('\n')) {
+    if (line.startsWith("VmHWM:"))
+      return line.mid(6).trimmed().split(' ').first().toLongLong();
+  }
+  return -1;
+}
+
+}
+
 void TestCppFiles::initTestCase()
 {
   //Intentionally load all plugins, otherwise for some reasons kdevcompilerprovider won't be loaded even if write it name here...
   AutoTestShell::init();
   TestCore::initialize(KDevelop::Core::NoUi);
   DUChain::self()->disablePersistentStorage();
-  Core::self()->languageController()->backgroundParser()->setDelay(0);
+  BackgroundParser* parser = Core::self()->languageController()->backgroundParser();
+  parser->setDelay(0);
   CodeRepresentation::setDiskChangesForbidden(true);
+
+  //Parse all files at once, using all cores, the single tests then only validate the results
+  parser->setThreadCount(qMax(2, QThread::idealThreadCount()));
+  const QStringList files = testFilePaths();
+  m_parseTimer.start();
+  foreach (const QString& file, files)
+    parser->addDocument(IndexedString(file), KDevelop::TopDUContext::AllDeclarationsContextsAndUses, 0, this);
+
+  const qint64 timeout = 60000 + 1000 * files.size();
+  while (m_parseTimes.size() < files.size() && m_parseTimer.elapsed() < timeout)
+    QTest::qWait(50);
+
+  qDebug() << "parsed" << m_parseTimes.size() << "of" << files.size() << "files in" << m_parseTimer.elapsed() << "ms,"
+           << "peak memory" << peakMemoryKb() << "kB";
 }
+
+void TestCppFiles::updateReady(const IndexedString& url, const ReferencedTopDUContext& /*topContext*/)
+{
+  m_parseTimes.insert(url.str(), m_parseTimer.elapsed());
+}
+
 void TestCppFiles::cleanupTestCase()
 {
   TestCore::shutdown();
@@ -77,10 +135,8 @@ void TestCppFiles::cleanupTestCase()
 void TestCppFiles::testFiles_data()
 {
   QTest::addColumn<QString>("fileName");
-  const QString testDirPath = CPP_TEST_FILES_DIR;
-  QStringList files = QDir(testDirPath).entryList(QStringList() << "*.cpp", QDir::Files);
-  foreach (QString file, files) {
-    QTest::newRow(file.toUtf8()) << QString(testDirPath + "/" + file);
+  foreach (const QString& file, testFilePaths()) {
+    QTest::newRow(QFileInfo(file).fileName().toUtf8()) << file;
   }
 }
 void TestCppFiles::testFiles()
@@ -99,6 +155,7 @@ void TestCppFiles::testFiles()
   }
 
   top->visit(validator);
+  qDebug() << fileName << "parsed after" << m_parseTimes.value(indexedFileName.str(), -1) << "ms,"
+           << top->localDeclarations().size() << "top-level declarations";
   QVERIFY(validator.testsPassed());
 }
-
@@ -19,16 +19,27 @@
 #ifndef TEST_CPPFILES_H
 #define TEST_CPPFILES_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 
+#include <language/duchain/topducontext.h>
+
 class TestCppFiles: public QObject
 {
   Q_OBJECT
+public slots:
+  ///Called by the background parser when one of the test files is parsed
+  void updateReady(const KDevelop::IndexedString& url, const KDevelop::ReferencedTopDUContext& topContext);
 private slots:
   void initTestCase();
   void cleanupTestCase();
   void testFiles_data();
   void testFiles();
+private:
+  QElapsedTimer m_parseTimer;
+  ///Milliseconds from scheduling all files until each of them was parsed
+  QHash<QString, qint64> m_parseTimes;
 };
 
 #endif //TEST_CPPFILES_H
@@ -0,0 +1,165 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "test_parsescheduler.h"
+
+#include "parsescheduler.h"
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace KDevelop;
+
+QTEST_GUILESS_MAIN(TestParseScheduler)
+
+void TestParseScheduler::initTestCase()
+{
+  AutoTestShell::init(QStringList() << "kdevcppsupport");
+  TestCore::initialize(Core::NoUi);
+}
+
+void TestParseScheduler::cleanupTestCase()
+{
+  TestCore::shutdown();
+}
+
+QString TestParseScheduler::createFile(const QTemporaryDir& dir, const QString& name, const QByteArray& contents)
+{
+  const QString path = dir.path() + '/' + name;
+  QDir().mkpath(QFileInfo(path).path());
+  QFile file(path);
+  if(!file.open(QIODevice::WriteOnly))
+    return QString();
+  file.write(contents);
+  return path;
+}
+
+void TestParseScheduler::testIncludeHeights()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const IndexedString base(createFile(dir, "base.h", "int base;\n"));
+  const IndexedString middle(createFile(dir, "middle.h", "#include \"base.h\"\n"));
+  const IndexedString top(createFile(dir, "top.h", "#include \"middle.h\"\n#include \"base.h\"\n"));
+  const IndexedString source(createFile(dir, "source.cpp", "#include \"top.h\"\n#include <vector>\n"));
+  //The macros deciding the conditions are unknown while scanning, so includes in all branches count
+  const IndexedString conditional(createFile(dir, "conditional.cpp", "#ifdef UNDEFINED\n#include \"source.cpp\"\n#endif\n"));
+  //Includes of files outside the given set are ignored
+  const IndexedString outside(createFile(dir, "outside.h", "#include \"unknown.h\"\n"));
+
+  const QHash<IndexedString, int> heights = ParseScheduler::includeHeights(QSet<IndexedString>() << base << middle << top << source << outside << conditional);
+  QCOMPARE(heights.size(), 6);
+  QCOMPARE(heights[base], 0);
+  QCOMPARE(heights[middle], 1);
+  QCOMPARE(heights[top], 2);
+  QCOMPARE(heights[source], 3);
+  QCOMPARE(heights[outside], 0);
+  QCOMPARE(heights[conditional], 4);
+}
+
+void TestParseScheduler::testIncludeCycle()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const IndexedString first(createFile(dir, "first.h", "#include \"second.h\"\n"));
+  const IndexedString second(createFile(dir, "second.h", "#include \"first.h\"\n"));
+  const IndexedString user(createFile(dir, "user.cpp", "#include \"first.h\"\n"));
+
+  //Which of the files in the cycle is parsed first depends on the order of traversal, but the cycle is broken
+  const QHash<IndexedString, int> heights = ParseScheduler::includeHeights(QSet<IndexedString>() << first << second << user);
+  QCOMPARE(heights.size(), 3);
+  QVERIFY(heights[first] != heights[second]);
+  QVERIFY(qMax(heights[first], heights[second]) <= 2);
+  QVERIFY(heights[user] > heights[first]);
+}
+
+void TestParseScheduler::testLocalIncludeResolution()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const IndexedString base(createFile(dir, "base.h", "int base;\n"));
+  const IndexedString upper(createFile(dir, "upper.h", "#include \"base.h\"\n"));
+  const IndexedString shadowed(createFile(dir, "config.h", "#include \"upper.h\"\n"));
+  const IndexedString local(createFile(dir, "sub/config.h", "int local;\n"));
+  const IndexedString source(createFile(dir, "sub/source.cpp", "#include \"config.h\"\n"));
+  //Includes that are not next to the including file are resolved by name
+  const IndexedString byName(createFile(dir, "other/user.cpp", "#include <sub/config.h>\n#include <upper.h>\n"));
+
+  const QHash<IndexedString, int> heights = ParseScheduler::includeHeights(QSet<IndexedString>() << base << upper << shadowed << local << source << byName);
+  QCOMPARE(heights[shadowed], 2);
+  QCOMPARE(heights[local], 0);
+  //The config.h next to the source-file is preferred over the one with the same name elsewhere
+  QCOMPARE(heights[source], 1);
+  QCOMPARE(heights[byName], 2);
+}
+
+void TestParseScheduler::testIncludeCandidates()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const IndexedString nearConfig(createFile(dir, "a/config.h", "int near;\n"));
+  const IndexedString extra(createFile(dir, "b/extra.h", "int extra;\n"));
+  const IndexedString farConfig(createFile(dir, "b/config.h", "#include \"extra.h\"\n"));
+  const IndexedString user(createFile(dir, "a/sub/user.cpp", "#include <config.h>\n"));
+  //Without a closer candidate, the first path is picked, so the result does not depend on the order of the files
+  const IndexedString other(createFile(dir, "c/other.cpp", "#include <config.h>\n"));
+
+  const QHash<IndexedString, int> heights = ParseScheduler::includeHeights(QSet<IndexedString>() << nearConfig << extra << farConfig << user << other);
+  QCOMPARE(heights[farConfig], 1);
+  //Only the config.h closest to the including file counts, as only one of them would be included
+  QCOMPARE(heights[user], 1);
+  QCOMPARE(heights[other], 1);
+}
+
+void TestParseScheduler::testHeightBatches()
+{
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const IndexedString base(createFile(dir, "base.h", "int base;\n"));
+  const IndexedString middle(createFile(dir, "middle.h", "#include \"base.h\"\n"));
+  const IndexedString top(createFile(dir, "top.h", "#include \"middle.h\"\n"));
+  const IndexedString first(createFile(dir, "first.h", "#include \"second.h\"\n#include \"base.h\"\n"));
+  const IndexedString second(createFile(dir, "second.h", "#include \"first.h\"\n"));
+  const QSet<IndexedString> files = QSet<IndexedString>() << base << middle << top << first << second;
+
+  QList<QHash<IndexedString, int> > batches;
+  const QHash<IndexedString, int> heights = ParseScheduler::includeHeights(files, [&batches] (const QHash<IndexedString, int>& found) {
+    batches << found;
+  }, 1);
+
+  //Every height is delivered once, and never before the heights of the files it depends on
+  QHash<IndexedString, int> delivered;
+  QHash<IndexedString, int> batchOfFile;
+  for(int batch = 0; batch < batches.size(); ++batch) {
+    for(QHash<IndexedString, int>::const_iterator it = batches[batch].constBegin(); it != batches[batch].constEnd(); ++it) {
+      QVERIFY(!delivered.contains(it.key()));
+      delivered.insert(it.key(), *it);
+      batchOfFile.insert(it.key(), batch);
+    }
+  }
+  QCOMPARE(delivered, heights);
+  QVERIFY(batchOfFile[base] <= batchOfFile[middle]);
+  QVERIFY(batchOfFile[middle] <= batchOfFile[top]);
+  //The files in the cycle only get their heights at the end
+  QCOMPARE(batchOfFile[first], batches.size() - 1);
+  QCOMPARE(batchOfFile[second], batches.size() - 1);
+}